@@ -1 +1 @@
-from menpo.basis.rbf import R2LogR, R2LogR2
+from menpo.basis.rbf import R2LogR, R2LogR2, Gaussian, Multiquadric
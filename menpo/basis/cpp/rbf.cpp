@@ -0,0 +1,425 @@
+#include "rbf.h"
+
+#include <math.h>
+#include <vector>
+
+// The radial functions, each a function of the squared distance r2. dU/dx
+// is always dudx_factor(r2) * (x - c), so every kernel shares the same
+// loops below.
+struct R2LogR2Function
+{
+    explicit R2LogR2Function(double) {}
+    inline double value(double r2) const
+    {
+        return r2 > 0 ? r2 * log(r2) : 0.0;
+    }
+    inline double dudx_factor(double r2) const
+    {
+        return r2 > 0 ? 2 * (log(r2) + 1) : 0.0;
+    }
+};
+
+struct R2LogRFunction
+{
+    explicit R2LogRFunction(double) {}
+    inline double value(double r2) const
+    {
+        // r^2 log(r) = r^2 log(r^2) / 2
+        return r2 > 0 ? 0.5 * r2 * log(r2) : 0.0;
+    }
+    inline double dudx_factor(double r2) const
+    {
+        return r2 > 0 ? log(r2) + 1 : 0.0;
+    }
+};
+
+struct GaussianFunction
+{
+    // parameter is sigma
+    explicit GaussianFunction(double sigma) : scale(1.0 / (2 * sigma * sigma)) {}
+    inline double value(double r2) const
+    {
+        return exp(-r2 * scale);
+    }
+    inline double dudx_factor(double r2) const
+    {
+        return -2 * scale * exp(-r2 * scale);
+    }
+    const double scale;
+};
+
+struct MultiquadricFunction
+{
+    // parameter is the additive scale
+    explicit MultiquadricFunction(double scale) : scale2(scale * scale) {}
+    inline double value(double r2) const
+    {
+        return sqrt(r2 + scale2);
+    }
+    inline double dudx_factor(double r2) const
+    {
+        const double u = sqrt(r2 + scale2);
+        return u > 0 ? 1.0 / u : 0.0;
+    }
+    const double scale2;
+};
+
+static inline size_t block_end(long b, size_t n_points)
+{
+    const size_t end = (b + 1) * RBF_BLOCK_SIZE;
+    return end < n_points ? end : n_points;
+}
+
+static inline long n_blocks_for(size_t n_points)
+{
+    return (long)((n_points + RBF_BLOCK_SIZE - 1) / RBF_BLOCK_SIZE);
+}
+
+// the kernel between a point and every centre, written to u
+template <class Function>
+static inline void kernel_row(const Function &U, const double *x,
+                              const double *centres, size_t n_centres,
+                              size_t n_dims, double *u)
+{
+    #pragma omp simd
+    for (size_t l = 0; l < n_centres; l++)
+    {
+        double r2 = 0;
+        for (size_t d = 0; d < n_dims; d++)
+        {
+            const double diff = x[d] - centres[l * n_dims + d];
+            r2 += diff * diff;
+        }
+        u[l] = U.value(r2);
+    }
+}
+
+template <class Function>
+static void apply(const Function &U,
+                  const double *points, size_t n_points,
+                  const double *centres, size_t n_centres, size_t n_dims,
+                  double *out)
+{
+    const long n_blocks = n_blocks_for(n_points);
+    #pragma omp parallel for schedule(static)
+    for (long b = 0; b < n_blocks; b++)
+    {
+        const size_t end = block_end(b, n_points);
+        for (size_t i = b * RBF_BLOCK_SIZE; i < end; i++)
+        {
+            kernel_row(U, points + i * n_dims, centres, n_centres, n_dims,
+                       out + i * n_centres);
+        }
+    }
+}
+
+template <class Function>
+static void apply_and_contract(const Function &U,
+                               const double *points, size_t n_points,
+                               const double *centres, size_t n_centres,
+                               size_t n_dims, const double *weights,
+                               size_t n_outputs, double *out)
+{
+    const long n_blocks = n_blocks_for(n_points);
+    #pragma omp parallel
+    {
+        // the kernel values of a single point - the only scratch we need
+        std::vector<double> u(n_centres);
+        #pragma omp for schedule(static)
+        for (long b = 0; b < n_blocks; b++)
+        {
+            const size_t end = block_end(b, n_points);
+            for (size_t i = b * RBF_BLOCK_SIZE; i < end; i++)
+            {
+                kernel_row(U, points + i * n_dims, centres, n_centres, n_dims,
+                           &u[0]);
+                double *o = out + i * n_outputs;
+                for (size_t k = 0; k < n_outputs; k++)
+                {
+                    o[k] = 0;
+                }
+                for (size_t l = 0; l < n_centres; l++)
+                {
+                    const double *w = weights + l * n_outputs;
+                    for (size_t k = 0; k < n_outputs; k++)
+                    {
+                        o[k] += u[l] * w[k];
+                    }
+                }
+            }
+        }
+    }
+}
+
+template <class Function>
+static void jacobian_points(const Function &U,
+                            const double *points, size_t n_points,
+                            const double *centres, size_t n_centres,
+                            size_t n_dims, double *out)
+{
+    const long n_blocks = n_blocks_for(n_points);
+    #pragma omp parallel for schedule(static)
+    for (long b = 0; b < n_blocks; b++)
+    {
+        const size_t end = block_end(b, n_points);
+        for (size_t i = b * RBF_BLOCK_SIZE; i < end; i++)
+        {
+            const double *x = points + i * n_dims;
+            for (size_t l = 0; l < n_centres; l++)
+            {
+                const double *c = centres + l * n_dims;
+                double *o = out + (i * n_centres + l) * n_dims;
+                double r2 = 0;
+                for (size_t d = 0; d < n_dims; d++)
+                {
+                    r2 += (x[d] - c[d]) * (x[d] - c[d]);
+                }
+                const double f = U.dudx_factor(r2);
+                for (size_t d = 0; d < n_dims; d++)
+                {
+                    o[d] = f * (x[d] - c[d]);
+                }
+            }
+        }
+    }
+}
+
+template <class Function>
+static void jacobian_points_and_contract(const Function &U,
+                                         const double *points, size_t n_points,
+                                         const double *centres, size_t n_centres,
+                                         size_t n_dims, const double *weights,
+                                         size_t n_outputs, double *out)
+{
+    const long n_blocks = n_blocks_for(n_points);
+    #pragma omp parallel for schedule(static)
+    for (long b = 0; b < n_blocks; b++)
+    {
+        const size_t end = block_end(b, n_points);
+        for (size_t i = b * RBF_BLOCK_SIZE; i < end; i++)
+        {
+            const double *x = points + i * n_dims;
+            double *o = out + i * n_dims * n_outputs;
+            for (size_t j = 0; j < n_dims * n_outputs; j++)
+            {
+                o[j] = 0;
+            }
+            for (size_t l = 0; l < n_centres; l++)
+            {
+                const double *c = centres + l * n_dims;
+                const double *w = weights + l * n_outputs;
+                double r2 = 0;
+                for (size_t d = 0; d < n_dims; d++)
+                {
+                    r2 += (x[d] - c[d]) * (x[d] - c[d]);
+                }
+                const double f = U.dudx_factor(r2);
+                for (size_t d = 0; d < n_dims; d++)
+                {
+                    const double dudx = f * (x[d] - c[d]);
+                    for (size_t k = 0; k < n_outputs; k++)
+                    {
+                        o[d * n_outputs + k] += dudx * w[k];
+                    }
+                }
+            }
+        }
+    }
+}
+
+template <class Function>
+static void tps_source_jacobian(const Function &U,
+                                const double *points, size_t n_points,
+                                const double *centres, size_t n_centres,
+                                const double *inv_l, const double *coefficients,
+                                const double *point_coefficients,
+                                const double *basis, size_t n_basis,
+                                double *out)
+{
+    const size_t L = n_centres;
+    const size_t M = L + 3;
+    // dU/dx at each centre wrt every other centre, (L, L, 2). These are the
+    // only non-zero entries of the K block of dL/dc_{i,d}: row i is
+    // aux[i, :, d] and column i is -aux[:, i, d].
+    std::vector<double> aux(L * L * 2);
+    jacobian_points(U, centres, L, centres, L, 2, &aux[0]);
+    // the row i contribution does not depend on the point:
+    // R[i, d] = sum_b aux[i, b, d] coefficients[b, d]
+    std::vector<double> R(L * 2, 0.0);
+    for (size_t i = 0; i < L; i++)
+    {
+        for (size_t b = 0; b < L; b++)
+        {
+            for (size_t d = 0; d < 2; d++)
+            {
+                R[i * 2 + d] += aux[(i * L + b) * 2 + d] * coefficients[b * 2 + d];
+            }
+        }
+    }
+    const long n_blocks = n_blocks_for(n_points);
+    #pragma omp parallel
+    {
+        std::vector<double> k(M), g(M), S(L * 2), J(L * 2);
+        #pragma omp for schedule(static)
+        for (long b = 0; b < n_blocks; b++)
+        {
+            const size_t end = block_end(b, n_points);
+            for (size_t n = b * RBF_BLOCK_SIZE; n < end; n++)
+            {
+                const double *x = points + n * 2;
+                // k(x), stashing the dU/dx factor in J for the point term
+                for (size_t l = 0; l < L; l++)
+                {
+                    const double dx = x[0] - centres[l * 2];
+                    const double dy = x[1] - centres[l * 2 + 1];
+                    const double r2 = dx * dx + dy * dy;
+                    k[l] = U.value(r2);
+                    const double f = U.dudx_factor(r2);
+                    J[l * 2] = f * dx;
+                    J[l * 2 + 1] = f * dy;
+                }
+                k[L] = 1;
+                k[L + 1] = x[0];
+                k[L + 2] = x[1];
+                // g = inv_l k (inv_l is symmetric)
+                for (size_t a = 0; a < M; a++)
+                {
+                    double acc = 0;
+                    const double *row = inv_l + a * M;
+                    for (size_t c = 0; c < M; c++)
+                    {
+                        acc += row[c] * k[c];
+                    }
+                    g[a] = acc;
+                }
+                // the column i contribution: S[i, d] = sum_a g_a aux[a, i, d]
+                for (size_t j = 0; j < L * 2; j++)
+                {
+                    S[j] = 0;
+                }
+                for (size_t a = 0; a < L; a++)
+                {
+                    const double ga = g[a];
+                    const double *aux_a = &aux[a * L * 2];
+                    for (size_t j = 0; j < L * 2; j++)
+                    {
+                        S[j] += ga * aux_a[j];
+                    }
+                }
+                for (size_t i = 0; i < L; i++)
+                {
+                    for (size_t d = 0; d < 2; d++)
+                    {
+                        const double c_i = coefficients[i * 2 + d];
+                        // the affine block contributes -1 at (i, L + 1 + d)
+                        // and at (L + 1 + d, i)
+                        double j = -g[i] * R[i * 2 + d] + c_i * S[i * 2 + d] +
+                                   g[i] * coefficients[(L + 1 + d) * 2 + d] +
+                                   g[L + 1 + d] * c_i;
+                        if (point_coefficients)
+                        {
+                            j += J[i * 2 + d] * point_coefficients[i * 2 + d];
+                        }
+                        J[i * 2 + d] = j;
+                    }
+                }
+                if (basis)
+                {
+                    double *o = out + n * n_basis * 2;
+                    for (size_t j = 0; j < n_basis * 2; j++)
+                    {
+                        o[j] = 0;
+                    }
+                    for (size_t i = 0; i < L; i++)
+                    {
+                        const double *basis_i = basis + i * n_basis * 2;
+                        for (size_t j = 0; j < n_basis * 2; j++)
+                        {
+                            o[j] += J[i * 2 + (j & 1)] * basis_i[j];
+                        }
+                    }
+                }
+                else
+                {
+                    double *o = out + n * L * 2;
+                    for (size_t j = 0; j < L * 2; j++)
+                    {
+                        o[j] = J[j];
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Instantiates the specialisation of an engine function for the requested
+// kernel and calls it with the radial function as the first argument.
+#define RBF_DISPATCH(kernel, parameter, function, ...)                 \
+    switch (kernel)                                                     \
+    {                                                                   \
+        case R2LOGR2:                                                   \
+            function(R2LogR2Function(parameter), __VA_ARGS__);          \
+            break;                                                      \
+        case R2LOGR:                                                    \
+            function(R2LogRFunction(parameter), __VA_ARGS__);           \
+            break;                                                      \
+        case GAUSSIAN:                                                  \
+            function(GaussianFunction(parameter), __VA_ARGS__);         \
+            break;                                                      \
+        case MULTIQUADRIC:                                              \
+            function(MultiquadricFunction(parameter), __VA_ARGS__);     \
+            break;                                                      \
+    }
+
+void rbf_apply(RBFKernel kernel, double parameter,
+               const double *points, size_t n_points,
+               const double *centres, size_t n_centres, size_t n_dims,
+               double *out)
+{
+    RBF_DISPATCH(kernel, parameter, apply,
+                 points, n_points, centres, n_centres, n_dims, out);
+}
+
+void rbf_apply_and_contract(RBFKernel kernel, double parameter,
+                            const double *points, size_t n_points,
+                            const double *centres, size_t n_centres,
+                            size_t n_dims, const double *weights,
+                            size_t n_outputs, double *out)
+{
+    RBF_DISPATCH(kernel, parameter, apply_and_contract,
+                 points, n_points, centres, n_centres, n_dims, weights,
+                 n_outputs, out);
+}
+
+void rbf_jacobian_points(RBFKernel kernel, double parameter,
+                         const double *points, size_t n_points,
+                         const double *centres, size_t n_centres,
+                         size_t n_dims, double *out)
+{
+    RBF_DISPATCH(kernel, parameter, jacobian_points,
+                 points, n_points, centres, n_centres, n_dims, out);
+}
+
+void rbf_jacobian_points_and_contract(RBFKernel kernel, double parameter,
+                                      const double *points, size_t n_points,
+                                      const double *centres, size_t n_centres,
+                                      size_t n_dims, const double *weights,
+                                      size_t n_outputs, double *out)
+{
+    RBF_DISPATCH(kernel, parameter, jacobian_points_and_contract,
+                 points, n_points, centres, n_centres, n_dims, weights,
+                 n_outputs, out);
+}
+
+void rbf_tps_source_jacobian(RBFKernel kernel, double parameter,
+                             const double *points, size_t n_points,
+                             const double *centres, size_t n_centres,
+                             const double *inv_l, const double *coefficients,
+                             const double *point_coefficients,
+                             const double *basis, size_t n_basis,
+                             double *out)
+{
+    RBF_DISPATCH(kernel, parameter, tps_source_jacobian,
+                 points, n_points, centres, n_centres, inv_l, coefficients,
+                 point_coefficients, basis, n_basis, out);
+}
@@ -0,0 +1,92 @@
+#ifndef RBF_H_
+#define RBF_H_
+
+#include <stddef.h>
+
+// Number of points each thread processes at a time. The centres and weights
+// are re-read for every point of a block, so they stay hot in cache.
+#define RBF_BLOCK_SIZE 256
+
+// The radial functions the engine is specialised for. Each is a function of
+// the squared distance r^2 = ||x - c||^2 between a point and a centre, with
+// an optional parameter:
+//
+//   R2LOGR2:      U = r^2 log(r^2)                   (U(0) = 0)
+//   R2LOGR:       U = r^2 log(r)                     (U(0) = 0)
+//   GAUSSIAN:     U = exp(-r^2 / (2 parameter^2))    (parameter = sigma)
+//   MULTIQUADRIC: U = sqrt(r^2 + parameter^2)        (parameter = scale)
+//
+// The implementations are templated on the radial function (see rbf.cpp) so
+// that the inner loops are specialised and vectorised per kernel; these
+// values only select the specialisation.
+enum RBFKernel { R2LOGR2, R2LOGR, GAUSSIAN, MULTIQUADRIC };
+
+// All arrays are C-contiguous doubles. points is (n_points, n_dims) and
+// centres is (n_centres, n_dims).
+
+// out[x, l] = U(||x - c_l||), out is (n_points, n_centres).
+void rbf_apply(RBFKernel kernel, double parameter,
+               const double *points, size_t n_points,
+               const double *centres, size_t n_centres, size_t n_dims,
+               double *out);
+
+// out[x, k] = sum_l U(||x - c_l||) weights[l, k]
+//
+// i.e. rbf_apply contracted with weights ((n_centres, n_outputs)) without
+// the (n_points, n_centres) kernel matrix ever being formed. out is
+// (n_points, n_outputs).
+void rbf_apply_and_contract(RBFKernel kernel, double parameter,
+                            const double *points, size_t n_points,
+                            const double *centres, size_t n_centres,
+                            size_t n_dims, const double *weights,
+                            size_t n_outputs, double *out);
+
+// out[x, l, d] = dU(||x - c_l||)/dx_d, out is (n_points, n_centres, n_dims).
+void rbf_jacobian_points(RBFKernel kernel, double parameter,
+                         const double *points, size_t n_points,
+                         const double *centres, size_t n_centres,
+                         size_t n_dims, double *out);
+
+// out[x, d, k] = sum_l dU(||x - c_l||)/dx_d weights[l, k]
+//
+// i.e. rbf_jacobian_points contracted with weights ((n_centres, n_outputs))
+// on the fly. out is (n_points, n_dims, n_outputs).
+void rbf_jacobian_points_and_contract(RBFKernel kernel, double parameter,
+                                      const double *points, size_t n_points,
+                                      const double *centres, size_t n_centres,
+                                      size_t n_dims, const double *weights,
+                                      size_t n_outputs, double *out);
+
+// The Jacobian of a 2D thin plate spline with the given kernel wrt its
+// L centres (source landmarks), evaluated at every point. With M = L + 3,
+//
+//   k(x) = [U(x, c_1), ..., U(x, c_L), 1, x_0, x_1]  and  g(x) = inv_l k(x)
+//
+// this is, for each centre i and dimension d, the derivative of the d'th
+// component of the spline (solved for coefficients, (M, 2)) as the d'th
+// coordinate of c_i moves:
+//
+//   out[x, i, d] = -k(x)^T inv_l dL/dc_{i,d} inv_l y_d
+//                  + dU/dx_d(x, c_i) point_coefficients[i, d]
+//
+// where L is the (M, M) TPS system matrix and coefficients = inv_l y^T.
+// point_coefficients is (L, 2) and may be NULL, in which case that term is
+// dropped. Rather than building dL/dc_{i,d} (M x M x L x 2), the sparsity of
+// dL/dc_{i,d} (only row and column i are non-zero) is used so that the cost
+// per point is O(L^2), and nothing larger than (L, 2) is stored per point.
+//
+// If basis ((L, n_basis, 2)) is not NULL the Jacobian is contracted with it
+// as it is produced:
+//
+//   out[x, p, d] = sum_i J[x, i, d] basis[i, p, d]
+//
+// and out is (n_points, n_basis, 2), else it is (n_points, L, 2).
+void rbf_tps_source_jacobian(RBFKernel kernel, double parameter,
+                             const double *points, size_t n_points,
+                             const double *centres, size_t n_centres,
+                             const double *inv_l, const double *coefficients,
+                             const double *point_coefficients,
+                             const double *basis, size_t n_basis,
+                             double *out);
+
+#endif
@@ -0,0 +1,317 @@
+# distutils: language = c++
+# distutils: sources = menpo/basis/cpp/rbf.cpp
+# distutils: extra_compile_args = -fopenmp
+# distutils: extra_link_args = -fopenmp
+
+import numpy as np
+cimport numpy as np
+cimport cython
+
+# externally declare the compiled rbf engine
+cdef extern from "cpp/rbf.h" nogil:
+    cdef enum RBFKernel:
+        R2LOGR2
+        R2LOGR
+        GAUSSIAN
+        MULTIQUADRIC
+
+    void c_rbf_apply "rbf_apply"(
+        RBFKernel kernel, double parameter, const double *points,
+        size_t n_points, const double *centres, size_t n_centres,
+        size_t n_dims, double *out)
+    void c_rbf_apply_and_contract "rbf_apply_and_contract"(
+        RBFKernel kernel, double parameter, const double *points,
+        size_t n_points, const double *centres, size_t n_centres,
+        size_t n_dims, const double *weights, size_t n_outputs, double *out)
+    void c_rbf_jacobian_points "rbf_jacobian_points"(
+        RBFKernel kernel, double parameter, const double *points,
+        size_t n_points, const double *centres, size_t n_centres,
+        size_t n_dims, double *out)
+    void c_rbf_jacobian_points_and_contract \
+            "rbf_jacobian_points_and_contract"(
+        RBFKernel kernel, double parameter, const double *points,
+        size_t n_points, const double *centres, size_t n_centres,
+        size_t n_dims, const double *weights, size_t n_outputs, double *out)
+    void c_rbf_tps_source_jacobian "rbf_tps_source_jacobian"(
+        RBFKernel kernel, double parameter, const double *points,
+        size_t n_points, const double *centres, size_t n_centres,
+        const double *inv_l, const double *coefficients,
+        const double *point_coefficients, const double *basis,
+        size_t n_basis, double *out)
+
+
+KERNELS = {'r2logr2': R2LOGR2,
+           'r2logr': R2LOGR,
+           'gaussian': GAUSSIAN,
+           'multiquadric': MULTIQUADRIC}
+
+
+cdef RBFKernel _kernel(kernel) except *:
+    try:
+        return KERNELS[kernel]
+    except KeyError:
+        raise ValueError("Unknown kernel '{}': needs to be one of "
+                         "{}".format(kernel, sorted(KERNELS)))
+
+
+def _points_and_centres(points, centres):
+    x = np.require(points, dtype=np.float64, requirements=['C'])
+    c = np.require(centres, dtype=np.float64, requirements=['C'])
+    if x.shape[1] != c.shape[1]:
+        raise ValueError("points and centres must have the same "
+                         "dimensionality")
+    return x, c
+
+
+def _weights(weights, centres):
+    w = np.require(weights, dtype=np.float64, requirements=['C'])
+    if w.shape[0] != centres.shape[0]:
+        raise ValueError("there must be one row of weights per centre")
+    return w
+
+
+@cython.boundscheck(False)
+def rbf_apply(kernel, double parameter, points not None, centres not None):
+    r"""
+    Evaluates the radial basis ``kernel`` between every point and centre.
+
+    Parameters
+    ----------
+    kernel : {'r2logr2', 'r2logr', 'gaussian', 'multiquadric'}
+        The radial function to evaluate.
+    parameter : float
+        The parameter of the radial function (if any).
+    points : (N, D) ndarray
+        The points to evaluate the basis at.
+    centres : (L, D) ndarray
+        The centres of the basis.
+
+    Returns
+    -------
+    u : (N, L) ndarray
+        The basis evaluated at each point for each centre.
+    """
+    cdef RBFKernel k = _kernel(kernel)
+    cdef np.ndarray[np.float64_t, ndim=2, mode='c'] x, c
+    x, c = _points_and_centres(points, centres)
+    cdef np.ndarray[np.float64_t, ndim=2, mode='c'] out = np.zeros(
+        [x.shape[0], c.shape[0]], dtype=np.float64)
+    if out.size == 0:
+        return out
+    with nogil:
+        c_rbf_apply(k, parameter, &x[0, 0], x.shape[0], &c[0, 0],
+                    c.shape[0], c.shape[1], &out[0, 0])
+    return out
+
+
+@cython.boundscheck(False)
+def rbf_apply_and_contract(kernel, double parameter, points not None,
+                           centres not None, weights not None):
+    r"""
+    Evaluates the radial basis ``kernel`` at ``points`` and contracts it
+    with ``weights`` in a single pass, i.e.::
+
+        rbf_apply(kernel, parameter, points, centres).dot(weights)
+
+    without the (N, L) kernel matrix ever being built.
+
+    Parameters
+    ----------
+    kernel : {'r2logr2', 'r2logr', 'gaussian', 'multiquadric'}
+        The radial function to evaluate.
+    parameter : float
+        The parameter of the radial function (if any).
+    points : (N, D) ndarray
+        The points to evaluate the basis at.
+    centres : (L, D) ndarray
+        The centres of the basis.
+    weights : (L, K) ndarray
+        The weight of each centre for each of the ``K`` outputs.
+
+    Returns
+    -------
+    out : (N, K) ndarray
+        The contracted basis.
+    """
+    cdef RBFKernel k = _kernel(kernel)
+    cdef np.ndarray[np.float64_t, ndim=2, mode='c'] x, c, w
+    x, c = _points_and_centres(points, centres)
+    w = _weights(weights, c)
+    cdef np.ndarray[np.float64_t, ndim=2, mode='c'] out = np.zeros(
+        [x.shape[0], w.shape[1]], dtype=np.float64)
+    if out.size == 0 or c.shape[0] == 0:
+        return out
+    with nogil:
+        c_rbf_apply_and_contract(k, parameter, &x[0, 0], x.shape[0],
+                                 &c[0, 0], c.shape[0], c.shape[1], &w[0, 0],
+                                 w.shape[1], &out[0, 0])
+    return out
+
+
+@cython.boundscheck(False)
+def rbf_jacobian_points(kernel, double parameter, points not None,
+                        centres not None):
+    r"""
+    The derivative of the radial basis ``kernel`` wrt the coordinate system,
+    evaluated at ``points``.
+
+    Parameters
+    ----------
+    kernel : {'r2logr2', 'r2logr', 'gaussian', 'multiquadric'}
+        The radial function to differentiate.
+    parameter : float
+        The parameter of the radial function (if any).
+    points : (N, D) ndarray
+        The points to evaluate the derivative at.
+    centres : (L, D) ndarray
+        The centres of the basis.
+
+    Returns
+    -------
+    dudx : (N, L, D) ndarray
+        The derivative of each centre's basis at each point.
+    """
+    cdef RBFKernel k = _kernel(kernel)
+    cdef np.ndarray[np.float64_t, ndim=2, mode='c'] x, c
+    x, c = _points_and_centres(points, centres)
+    cdef np.ndarray[np.float64_t, ndim=3, mode='c'] out = np.zeros(
+        [x.shape[0], c.shape[0], c.shape[1]], dtype=np.float64)
+    if out.size == 0:
+        return out
+    with nogil:
+        c_rbf_jacobian_points(k, parameter, &x[0, 0], x.shape[0], &c[0, 0],
+                              c.shape[0], c.shape[1], &out[0, 0, 0])
+    return out
+
+
+@cython.boundscheck(False)
+def rbf_jacobian_points_and_contract(kernel, double parameter,
+                                     points not None, centres not None,
+                                     weights not None):
+    r"""
+    The derivative of the radial basis ``kernel`` wrt the coordinate system,
+    contracted with ``weights`` in a single pass, i.e.::
+
+        np.einsum('nld, lk -> ndk',
+                  rbf_jacobian_points(kernel, parameter, points, centres),
+                  weights)
+
+    without the (N, L, D) Jacobian ever being built.
+
+    Parameters
+    ----------
+    kernel : {'r2logr2', 'r2logr', 'gaussian', 'multiquadric'}
+        The radial function to differentiate.
+    parameter : float
+        The parameter of the radial function (if any).
+    points : (N, D) ndarray
+        The points to evaluate the derivative at.
+    centres : (L, D) ndarray
+        The centres of the basis.
+    weights : (L, K) ndarray
+        The weight of each centre for each of the ``K`` outputs.
+
+    Returns
+    -------
+    out : (N, D, K) ndarray
+        The contracted derivative.
+    """
+    cdef RBFKernel k = _kernel(kernel)
+    cdef np.ndarray[np.float64_t, ndim=2, mode='c'] x, c, w
+    x, c = _points_and_centres(points, centres)
+    w = _weights(weights, c)
+    cdef np.ndarray[np.float64_t, ndim=3, mode='c'] out = np.zeros(
+        [x.shape[0], x.shape[1], w.shape[1]], dtype=np.float64)
+    if out.size == 0 or c.shape[0] == 0:
+        return out
+    with nogil:
+        c_rbf_jacobian_points_and_contract(
+            k, parameter, &x[0, 0], x.shape[0], &c[0, 0], c.shape[0],
+            c.shape[1], &w[0, 0], w.shape[1], &out[0, 0, 0])
+    return out
+
+
+@cython.boundscheck(False)
+def rbf_tps_source_jacobian(kernel, double parameter, points not None,
+                            centres not None, inv_l not None,
+                            coefficients not None, point_coefficients=None,
+                            basis=None):
+    r"""
+    The Jacobian of a 2D thin plate spline with the given kernel wrt its
+    centres (source landmarks), evaluated at ``points``.
+
+    Only the rows and columns of the derivative of the TPS system matrix
+    that belong to the moving centre are non-zero, which is used to compute
+    the Jacobian in :math:`O(L^2)` per point without building the
+    derivative of the system matrix.
+
+    Parameters
+    ----------
+    kernel : {'r2logr2', 'r2logr', 'gaussian', 'multiquadric'}
+        The radial function of the TPS.
+    parameter : float
+        The parameter of the radial function (if any).
+    points : (N, 2) ndarray
+        The points to evaluate the Jacobian at.
+    centres : (L, 2) ndarray
+        The source landmarks of the TPS.
+    inv_l : (L + 3, L + 3) ndarray
+        The inverse of the TPS system matrix.
+    coefficients : (L + 3, 2) ndarray
+        The TPS coefficients, ``inv_l.dot(y.T)``.
+    point_coefficients : (L, 2) ndarray, optional
+        If provided, the derivative of the kernel at the points weighted by
+        these is added to the Jacobian (the centres moving the kernel).
+    basis : (L, P, 2) ndarray, optional
+        If provided, the Jacobian is contracted with this as it is computed
+        and the (N, L, 2) Jacobian is never built.
+
+    Returns
+    -------
+    dW/dp : (N, L, 2) or (N, P, 2) ndarray
+        The Jacobian wrt the centres, or its contraction with ``basis``.
+    """
+    cdef np.ndarray[np.float64_t, ndim=2, mode='c'] x = np.require(
+        points, dtype=np.float64, requirements=['C'])
+    cdef np.ndarray[np.float64_t, ndim=2, mode='c'] c = np.require(
+        centres, dtype=np.float64, requirements=['C'])
+    cdef np.ndarray[np.float64_t, ndim=2, mode='c'] a = np.require(
+        inv_l, dtype=np.float64, requirements=['C'])
+    cdef np.ndarray[np.float64_t, ndim=2, mode='c'] w = np.require(
+        coefficients, dtype=np.float64, requirements=['C'])
+    cdef np.ndarray[np.float64_t, ndim=2, mode='c'] pw
+    cdef np.ndarray[np.float64_t, ndim=3, mode='c'] b
+    cdef double *pw_ptr = NULL
+    cdef double *b_ptr = NULL
+    cdef size_t n_basis = 0
+    cdef size_t n_centres = c.shape[0]
+    cdef RBFKernel k = _kernel(kernel)
+    if x.shape[1] != 2 or c.shape[1] != 2:
+        raise ValueError("the TPS source Jacobian is only defined in 2D")
+    if (a.shape[0] != n_centres + 3 or a.shape[1] != n_centres + 3 or
+            w.shape[0] != n_centres + 3 or w.shape[1] != 2):
+        raise ValueError("inv_l and coefficients must match the centres")
+    if point_coefficients is not None:
+        pw = np.require(point_coefficients, dtype=np.float64,
+                        requirements=['C'])
+        if pw.shape[0] != n_centres or pw.shape[1] != 2:
+            raise ValueError("there must be one row of point_coefficients "
+                             "per centre")
+        pw_ptr = &pw[0, 0]
+    if basis is not None:
+        b = np.require(basis, dtype=np.float64, requirements=['C'])
+        if b.shape[0] != n_centres or b.shape[2] != 2:
+            raise ValueError("basis must be (L, P, 2)")
+        n_basis = b.shape[1]
+        if n_basis > 0:
+            b_ptr = &b[0, 0, 0]
+    cdef np.ndarray[np.float64_t, ndim=3, mode='c'] out = np.zeros(
+        [x.shape[0], n_basis if basis is not None else n_centres, 2],
+        dtype=np.float64)
+    if out.size == 0:
+        return out
+    with nogil:
+        c_rbf_tps_source_jacobian(k, parameter, &x[0, 0], x.shape[0],
+                                  &c[0, 0], n_centres, &a[0, 0], &w[0, 0],
+                                  pw_ptr, b_ptr, n_basis, &out[0, 0, 0])
+    return out
@@ -1,6 +1,8 @@
 import abc
 import numpy as np
-from scipy.spatial.distance import cdist
+from menpo.basis.crbf import (rbf_apply, rbf_apply_and_contract,
+                              rbf_jacobian_points,
+                              rbf_jacobian_points_and_contract)
 
 
 class BasisFunction(object):
@@ -70,35 +72,77 @@ class BasisFunction(object):
         """
         pass
 
+    def apply_and_contract(self, x, weights):
+        r"""
+        Calculate the basis function at ``x`` and contract it with
+        ``weights``. Equivalent to ``self.apply(x).dot(weights)``, but
+        subclasses may do this without building the (N, L) basis.
 
-class R2LogR2(BasisFunction):
-    r"""
-    The :math:`r^2 \log{r^2}` basis function.
+        Parameters
+        ----------
+        x : (N, D) ndarray
+            Set of points to apply the basis to.
+        weights : (L, K) ndarray
+            The weight of each center for each of the ``K`` outputs.
 
-    The derivative of this function is :math:`2 r (\log{r^2} + 1)`.
+        Returns
+        -------
+        u : (N, K) ndarray
+            The contracted basis.
+        """
+        return self.apply(x).dot(weights)
 
-    .. note::
+    def jacobian_points_and_contract(self, x, weights):
+        r"""
+        Calculate the derivative of the basis function wrt the coordinate
+        system at ``x`` and contract it with ``weights``. Equivalent to
+        ``np.einsum('nld, lk -> ndk', self.jacobian_points(x), weights)``,
+        but subclasses may do this without building the (N, L, D) Jacobian.
 
-        :math:`r = \lVert x - c \rVert`
+        Parameters
+        ----------
+        x : (N, D) ndarray
+            Set of points to apply the basis to.
+        weights : (L, K) ndarray
+            The weight of each center for each of the ``K`` outputs.
+
+        Returns
+        -------
+        dudx : (N, D, K) ndarray
+            The contracted derivative.
+        """
+        return np.einsum('nld, lk -> ndk', self.jacobian_points(x), weights)
+
+
+class CompiledBasisFunction(BasisFunction):
+    r"""
+    A radial basis function evaluated by the compiled RBF engine
+    (``menpo/basis/cpp/rbf.cpp``), which is specialised per radial function
+    and multithreaded over blocks of points. Subclasses only choose the
+    ``kernel`` (and its ``parameter``, if any).
 
     Parameters
     ----------
     c : (L, D) ndarray
         The set of centers that make the basis. Usually represents a set of
         source landmarks.
+    parameter : float, optional
+        The parameter of the radial function, ignored by kernels without
+        one.
+
+        Default: 0
     """
 
-    def __init__(self, c):
-        super(R2LogR2, self).__init__(c)
+    kernel = None
+
+    def __init__(self, c, parameter=0.0):
+        super(CompiledBasisFunction, self).__init__(c)
+        self.parameter = parameter
 
     def apply(self, x):
-        """
+        r"""
         Apply the basis function.
 
-        .. note::
-
-            :math:`r^2 \log{r^2} === r^2 2 \log{r}`
-
         Parameters
         ----------
         x : (N, D) ndarray
@@ -110,31 +154,33 @@ class R2LogR2(BasisFunction):
             The basis function applied to each distance,
             :math:`\lVert x - c \rVert`.
         """
-        euclidean_distance = cdist(x, self.c)
-        mask = euclidean_distance == 0
-        with np.errstate(divide='ignore', invalid='ignore'):
-            u = (euclidean_distance ** 2 *
-                 (2 * np.log(euclidean_distance)))
-            # reset singularities to 0
-        u[mask] = 0
-        return u
-
-    def jacobian_points(self, x):
-        """
-        Apply the derivative of the basis function wrt the coordinate system.
-        This is applied over each dimension of the input vector, `x`.
+        return rbf_apply(self.kernel, self.parameter, x, self.c)
 
-        .. note::
-
-            ..math::
-
-                2 (x - c)^T (\log{r^2_{x, l}} + 1) ===
-                2 (x - c)^T (2 \log{r_{x, l}} + 1)
+    def apply_and_contract(self, x, weights):
+        r"""
+        Calculate the basis function at ``x`` and contract it with
+        ``weights``. This is done in a single pass, so the (N, L) basis is
+        never built.
 
-            where:
+        Parameters
+        ----------
+        x : (N, D) ndarray
+            Set of points to apply the basis to.
+        weights : (L, K) ndarray
+            The weight of each center for each of the ``K`` outputs.
 
-            :math:`r_{x, l} = \lVert x - c \rVert``
+        Returns
+        -------
+        u : (N, K) ndarray
+            ``self.apply(x).dot(weights)``
+        """
+        return rbf_apply_and_contract(self.kernel, self.parameter, x, self.c,
+                                      weights)
 
+    def jacobian_points(self, x):
+        r"""
+        Apply the derivative of the basis function wrt the coordinate system.
+        This is applied over each dimension of the input vector, `x`.
 
         Parameters
         ----------
@@ -147,16 +193,54 @@ class R2LogR2(BasisFunction):
             The jacobian tensor representing the first order partial derivative
             of each point wrt the coordinate system
         """
-        euclidean_distance = cdist(x, self.c)
-        component_distances = x[..., None, ...] - self.c
-        # Avoid log(0) and set to 1 so that log(1) = 0
-        euclidean_distance[euclidean_distance == 0] = 1
-        dudx = (2 * component_distances *
-                (2 * np.log(euclidean_distance[..., None]) + 1))
-        return dudx
+        return rbf_jacobian_points(self.kernel, self.parameter, x, self.c)
+
+    def jacobian_points_and_contract(self, x, weights):
+        r"""
+        Calculate the derivative of the basis function at ``x`` and contract
+        it with ``weights``. This is done in a single pass, so the (N, L, D)
+        Jacobian is never built.
+
+        Parameters
+        ----------
+        x : (N, D) ndarray
+            Set of points to apply the basis to.
+        weights : (L, K) ndarray
+            The weight of each center for each of the ``K`` outputs.
+
+        Returns
+        -------
+        dudx : (N, D, K) ndarray
+            The contracted derivative.
+        """
+        return rbf_jacobian_points_and_contract(self.kernel, self.parameter,
+                                                x, self.c, weights)
+
+
+class R2LogR2(CompiledBasisFunction):
+    r"""
+    The :math:`r^2 \log{r^2}` basis function.
+
+    The derivative of this function is :math:`2 r (\log{r^2} + 1)`.
+
+    .. note::
+
+        :math:`r = \lVert x - c \rVert`
+
+    Parameters
+    ----------
+    c : (L, D) ndarray
+        The set of centers that make the basis. Usually represents a set of
+        source landmarks.
+    """
 
+    kernel = 'r2logr2'
 
-class R2LogR(BasisFunction):
+    def __init__(self, c):
+        super(R2LogR2, self).__init__(c)
+
+
+class R2LogR(CompiledBasisFunction):
     r"""
     Calculates the :math:`r^2 \log{r}` basis function.
 
@@ -173,58 +257,79 @@ class R2LogR(BasisFunction):
         source landmarks.
     """
 
+    kernel = 'r2logr'
+
     def __init__(self, c):
         super(R2LogR, self).__init__(c)
 
-    def apply(self, x):
-        """
-        Apply the basis function :math:`r^2 \log{r}`.
 
-        Parameters
-        ----------
-        x : (N, D) ndarray
-            Set of points to apply the basis to.
+class Gaussian(CompiledBasisFunction):
+    r"""
+    The Gaussian basis function :math:`e^{-r^2 / 2 \sigma^2}`.
 
-        Returns
-        -------
-        u : (N, L) ndarray
-            The basis function applied to each distance,
-            :math:`\lVert x - c \rVert`.
-        """
-        euclidean_distance = cdist(x, self.c)
-        mask = euclidean_distance == 0
-        with np.errstate(divide='ignore', invalid='ignore'):
-            u = euclidean_distance ** 2 * np.log(euclidean_distance)
-        # reset singularities to 0
-        u[mask] = 0
-        return u
+    The derivative of this function is
+    :math:`-\frac{r}{\sigma^2} e^{-r^2 / 2 \sigma^2}`.
 
-    def jacobian_points(self, x):
-        """
-        The derivative of the basis function wrt the coordinate system
-        evaluated at `x`.
+    .. note::
 
-        :math:`(x - c)^T (1 + 2 \log{r_{x, l}})`.
+        :math:`r = \lVert x - c \rVert`
 
-        .. note::
+    Parameters
+    ----------
+    c : (L, D) ndarray
+        The set of centers that make the basis. Usually represents a set of
+        source landmarks.
+    sigma : float, optional
+        The standard deviation of the Gaussian.
 
-            :math:`r_{x, l} = \lVert x - c \rVert``
+        Default: 1
 
-        Parameters
-        ----------
-        x : (N, D) ndarray
-            Set of points to apply the basis to.
+    Raises
+    ------
+    ValueError
+        If ``sigma`` is not positive
+    """
 
-        Returns
-        -------
-        dudx : (N, L, D) ndarray
-            The jacobian tensor representing the first order partial derivative
-            of each points wrt the coordinate system
-        """
-        euclidean_distance = cdist(x, self.c)
-        component_distances = x[..., None, ...] - self.c
-        # Avoid log(0) and set to 1 so that log(1) = 0
-        euclidean_distance[euclidean_distance == 0] = 1
-        dudx = (component_distances *
-                (1 + 2 * np.log(euclidean_distance[..., None])))
-        return dudx
+    kernel = 'gaussian'
+
+    def __init__(self, c, sigma=1.0):
+        if sigma <= 0:
+            raise ValueError("The standard deviation of a Gaussian has to be "
+                             "positive (attempted to set {})".format(sigma))
+        super(Gaussian, self).__init__(c, parameter=sigma)
+
+
+class Multiquadric(CompiledBasisFunction):
+    r"""
+    The multiquadric basis function :math:`\sqrt{r^2 + s^2}`.
+
+    The derivative of this function is :math:`\frac{r}{\sqrt{r^2 + s^2}}`.
+
+    .. note::
+
+        :math:`r = \lVert x - c \rVert`
+
+    Parameters
+    ----------
+    c : (L, D) ndarray
+        The set of centers that make the basis. Usually represents a set of
+        source landmarks.
+    scale : float, optional
+        The scale, :math:`s`, of the multiquadric.
+
+        Default: 1
+
+    Raises
+    ------
+    ValueError
+        If ``scale`` is not positive (with :math:`s = 0` the derivative is
+        undefined at the centers)
+    """
+
+    kernel = 'multiquadric'
+
+    def __init__(self, c, scale=1.0):
+        if scale <= 0:
+            raise ValueError("The scale of a multiquadric has to be positive "
+                             "(attempted to set {})".format(scale))
+        super(Multiquadric, self).__init__(c, parameter=scale)
@@ -1,6 +1,7 @@
 from numpy.testing import assert_allclose
+from nose.tools import raises
 import numpy as np
-from menpo.basis import R2LogR2, R2LogR
+from menpo.basis import R2LogR2, R2LogR, Gaussian, Multiquadric
 
 centers = np.array([[-1.0, -1.0], [-1, 1], [1, -1], [1, 1]])
 points = np.array([[-0.4, -1.5], [-0.1, 1.1], [0.1, -2], [2.3, 0.3]])
@@ -64,3 +65,36 @@ def test_rbf_r2logr_jacobian():
                           [2.88323842, 2.88323842],
                           [2.31312234, -1.24552741]]])
     assert_allclose(result, expected)
+
+
+def test_rbf_r2logr2_apply_and_contract():
+    weights = np.array([[1., 0.5], [-2., 0.], [0.3, 1.], [0., -1.]])
+    result = R2LogR2(centers).apply_and_contract(points, weights)
+    assert_allclose(result, R2LogR2(centers).apply(points).dot(weights))
+
+
+def test_rbf_gaussian_apply_and_jacobian():
+    d = points[:, None, :] - centers
+    u = np.exp(-np.sum(d ** 2, axis=-1) / (2 * 0.5 ** 2))
+    basis = Gaussian(centers, sigma=0.5)
+    assert_allclose(basis.apply(points), u)
+    assert_allclose(basis.jacobian_points(points),
+                    -d / 0.5 ** 2 * u[..., None])
+
+
+def test_rbf_multiquadric_apply_and_jacobian():
+    d = points[:, None, :] - centers
+    u = np.sqrt(np.sum(d ** 2, axis=-1) + 2.0 ** 2)
+    basis = Multiquadric(centers, scale=2.0)
+    assert_allclose(basis.apply(points), u)
+    assert_allclose(basis.jacobian_points(points), d / u[..., None])
+
+
+@raises(ValueError)
+def test_rbf_gaussian_zero_sigma_raises():
+    Gaussian(centers, sigma=0)
+
+
+@raises(ValueError)
+def test_rbf_multiquadric_negative_scale_raises():
+    Multiquadric(centers, scale=-1.0)
@@ -1,5 +1,7 @@
 import collections
+import numpy as np
 from menpo.geodesics import kirsanov
+from menpo.geodesics.heat import HeatGeodesics
 from menpo.geodesics.exceptions import TriMeshGeodesicsError
 
 
@@ -18,6 +20,8 @@ class TriMeshGeodesics(object):
 
     def __init__(self, points, trilist):
         self._kirsanov = kirsanov.KirsanovGeodesics(points, trilist)
+        # the heat method's factorisations are only built if it is used
+        self._heat = None
         self.points = points
         self.trilist = trilist
 
@@ -30,36 +34,211 @@ class TriMeshGeodesics(object):
         """
         return self.points.shape[0]
 
-    def geodesics(self, source_indexes, method='exact'):
+    def geodesics(self, source_indexes, method='exact', subdivision_level=3,
+                  max_distance=None, targets=None):
         r"""
         Calculate the geodesic distance for all points from the
         given ``source_indexes``.
 
         Parameters
         -----------
-        source_indexes : (N,) list
+        source_indexes : (S,) list
             List of indexes to calculate the geodesics for
-        method : {'exact'}
-            The method using to calculate the geodesics. Only the 'exact'
-            method is currently supported
+        method : {'exact', 'dijkstra', 'subdivision', 'heat'}
+            The method using to calculate the geodesics. 'dijkstra' (paths
+            along the mesh edges) and 'subdivision' (paths along a finer
+            graph with ``subdivision_level`` nodes inserted on each edge)
+            are fast approximations of the 'exact' geodesics. 'heat' is the
+            smooth approximation of the heat method, which factorises the
+            mesh's Laplacian on first use and then answers every query with
+            a few sparse back substitutions - the fastest for repeated
+            queries on large meshes. (Finding ``best_source`` from many
+            sources takes a solve for each of them - for the distance
+            alone, ``HeatGeodesics.geodesics`` needs just the one.)
 
             Default: exact
+        subdivision_level : int, optional
+            The number of nodes inserted on each edge for the 'subdivision'
+            method. Levels of 2-3 are typically several times faster than
+            'exact', at the cost of slightly overestimating the distances.
+
+            Default: 3
+        max_distance : float, optional
+            If given, propagation stops once it is further than this from
+            the sources, and only the points within it are returned - e.g.
+            for a geodesic disc around each source. ('heat' always solves
+            over the whole mesh, and then returns the points within it.)
+        targets : (T,) list, optional
+            If given, propagation stops as soon as all of these points have
+            been reached (and, if ``max_distance`` is also given, it has gone
+            past ``max_distance``).
 
         Returns
         -------
-        TODO: document these?
-        phi : UNKNOWN
-        best_source : UNKNOWN
+        phi : (N,) or (R,) float64 ndarray
+            The geodesic distance of every point to its nearest source -
+            or, if ``max_distance`` or ``targets`` are given, of each of the
+            ``R`` points in ``indexes``
+        best_source : (N,) or (R,) uint32 ndarray
+            The index (in ``source_indexes``) of the nearest source to every
+            point, or to each of the points in ``indexes``
+        indexes : (R,) uint32 ndarray
+            Only if ``max_distance`` or ``targets`` are given, when ``phi``
+            and ``best_source`` are only given for these ``R`` points reached
 
         Raises
         -------
         TriMeshGeodesicsError
             When indexes are out of the range of the number of points
         """
-        if not isinstance(source_indexes, collections.Iterable):
-            source_indexes = [source_indexes]
-        if not all(0 <= i < self.n_points for i in source_indexes):
+        source_indexes = self._check_indexes(source_indexes)
+        if targets is not None:
+            targets = self._check_indexes(targets)
+        if method == 'heat':
+            return self._heat_geodesics(source_indexes, max_distance, targets)
+        return self._kirsanov.geodesics(source_indexes, method,
+                                        subdivision_level=subdivision_level,
+                                        max_distance=max_distance,
+                                        targets=targets)
+
+    def _heat_geodesics(self, source_indexes, max_distance, targets):
+        if self._heat is None:
+            self._heat = HeatGeodesics(self.points, self.trilist)
+        geodesic = self._heat.geodesics(source_indexes)
+        if max_distance is None and targets is None:
+            return geodesic
+        indexes = np.arange(self.n_points, dtype=np.uint32)
+        if max_distance is not None:
+            indexes = indexes[geodesic['phi'] <= max_distance]
+        return {'indexes': indexes, 'phi': geodesic['phi'][indexes],
+                'best_source': geodesic['best_source'][indexes]}
+
+    def distance_matrix(self, source_indexes):
+        r"""
+        Calculate the exact geodesic distance of all points from each of the
+        given ``source_indexes`` in turn (rather than from the nearest of
+        them, as :meth:`geodesics` does). The sources are propagated in
+        parallel.
+
+        Parameters
+        -----------
+        source_indexes : (S,) list
+            List of indexes to calculate the geodesics from
+
+        Returns
+        -------
+        distances : (S, N) ndarray
+            Row ``i`` is the geodesic distance of every point from
+            ``source_indexes[i]``
+
+        Raises
+        -------
+        TriMeshGeodesicsError
+            When indexes are out of the range of the number of points
+        """
+        source_indexes = self._check_indexes(source_indexes)
+        return self._kirsanov.geodesic_distance_matrix(source_indexes)
+
+    def farthest_point_sampling(self, n_samples, seed_indexes=0,
+                                method='exact', subdivision_level=3):
+        r"""
+        Sample ``n_samples`` points evenly over the surface by geodesic
+        farthest point sampling, and partition the mesh into the geodesic
+        Voronoi cells of the samples.
+
+        Starting from the ``seed_indexes``, the point furthest from all the
+        samples so far is repeatedly added. Each new sample is only
+        propagated as far as the current furthest distance, so the cost of
+        a sample shrinks as the sampling gets denser.
+
+        Parameters
+        -----------
+        n_samples : int
+            The number of samples to take, including the seeds
+        seed_indexes : (K,) list or int, optional
+            The index(es) the sampling starts from
+
+            Default: 0
+        method : {'exact', 'dijkstra', 'subdivision'}
+            The method using to calculate the geodesics (see
+            :meth:`geodesics`).
+
+            Default: exact
+        subdivision_level : int, optional
+            The number of nodes inserted on each edge for the 'subdivision'
+            method.
+
+            Default: 3
+
+        Returns
+        -------
+        samples : (S,) ndarray
+            The indexes of the samples, in the order they were taken. Fewer
+            than ``n_samples`` if every point has been sampled
+        phi : (N,) ndarray
+            The geodesic distance of every point to its nearest sample
+        best_source : (N,) ndarray
+            The index (in ``samples``) of the nearest sample to every point,
+            i.e. its Voronoi cell
+
+        Raises
+        -------
+        TriMeshGeodesicsError
+            When indexes are out of the range of the number of points
+        """
+        seed_indexes = self._check_indexes(seed_indexes)
+        return self._kirsanov.farthest_point_sampling(
+            n_samples, seed_indexes, method=method,
+            subdivision_level=subdivision_level)
+
+    def geodesic_paths(self, source_indexes, destination_indexes,
+                       method='exact', subdivision_level=3):
+        r"""
+        Calculate the geodesic paths across the surface from the nearest of
+        the ``source_indexes`` to each of the ``destination_indexes``. The
+        geodesics are propagated only once for all the paths.
+
+        Parameters
+        -----------
+        source_indexes : (S,) list
+            List of indexes the paths start from
+        destination_indexes : (D,) list
+            List of indexes to find the paths to
+        method : {'exact', 'dijkstra', 'subdivision'}
+            The method using to calculate the geodesics (see
+            :meth:`geodesics`).
+
+            Default: exact
+        subdivision_level : int, optional
+            The number of nodes inserted on each edge for the 'subdivision'
+            method.
+
+            Default: 3
+
+        Returns
+        -------
+        path_points : (P, 3) ndarray
+            The points of every path, concatenated. Each path runs from a
+            source to its destination.
+        path_offsets : (D + 1,) ndarray
+            Path ``i`` is ``path_points[path_offsets[i]:path_offsets[i + 1]]``
+
+        Raises
+        -------
+        TriMeshGeodesicsError
+            When indexes are out of the range of the number of points
+        """
+        source_indexes = self._check_indexes(source_indexes)
+        destination_indexes = self._check_indexes(destination_indexes)
+        return self._kirsanov.geodesic_paths(
+            source_indexes, destination_indexes, method=method,
+            subdivision_level=subdivision_level)
+
+    def _check_indexes(self, indexes):
+        if not isinstance(indexes, collections.Iterable):
+            indexes = [indexes]
+        if not all(0 <= i < self.n_points for i in indexes):
             raise TriMeshGeodesicsError('Invalid indexes ' +
                                         '(all must be in range  '
                                         '0 <= i < n_points)')
-        return self._kirsanov.geodesics(source_indexes, method)
+        return indexes
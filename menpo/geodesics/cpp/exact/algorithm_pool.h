@@ -0,0 +1,75 @@
+#pragma once
+
+#include <vector>
+#include "exactgeodesic/geodesic_mesh.h"
+
+// Geodesic algorithms are expensive to set up (every edge gets its interval
+// list, or every graph node is built, and the memory pools are allocated), so
+// rather than building one per query they are kept in a pool and reused -
+// each propagate() resets the previous query's state but keeps the memory.
+//
+// An algorithm is only ever used by one query at a time: concurrent queries
+// (e.g. the threads of a distance matrix) each take their own from the
+// pool, which grows to the largest number of queries that have run at once.
+template <class Algorithm>
+class AlgorithmPool {
+    public:
+        AlgorithmPool(geodesic::Mesh* mesh) : mesh(mesh) { }
+
+        ~AlgorithmPool() {
+            for (unsigned i = 0; i < algorithms.size(); i++) {
+                delete algorithms[i];
+            }
+        }
+
+        Algorithm* acquire() {
+            Algorithm* algorithm = NULL;
+            #pragma omp critical(geodesic_algorithm_pool)
+            {
+                if (!available.empty()) {
+                    algorithm = available.back();
+                    available.pop_back();
+                }
+            }
+            if (algorithm == NULL) {
+                algorithm = new Algorithm(mesh);
+                #pragma omp critical(geodesic_algorithm_pool)
+                algorithms.push_back(algorithm);
+            }
+            return algorithm;
+        }
+
+        void release(Algorithm* algorithm) {
+            #pragma omp critical(geodesic_algorithm_pool)
+            available.push_back(algorithm);
+        }
+
+    private:
+        AlgorithmPool(const AlgorithmPool&);
+        AlgorithmPool& operator=(const AlgorithmPool&);
+
+        geodesic::Mesh* mesh;
+        std::vector<Algorithm*> algorithms;
+        std::vector<Algorithm*> available;
+};
+
+// Holds an algorithm taken from a pool for the lifetime of a query, and
+// gives it back at the end of the scope.
+template <class Algorithm>
+class PooledAlgorithm {
+    public:
+        PooledAlgorithm(AlgorithmPool<Algorithm>& pool) :
+            pool(pool), algorithm(pool.acquire()) { }
+
+        ~PooledAlgorithm() { pool.release(algorithm); }
+
+        Algorithm* get() { return algorithm; }
+        Algorithm* operator->() { return algorithm; }
+
+    private:
+        PooledAlgorithm(const PooledAlgorithm&);
+        PooledAlgorithm& operator=(const PooledAlgorithm&);
+
+        AlgorithmPool<Algorithm>& pool;
+        Algorithm* algorithm;
+};
@@ -44,8 +44,6 @@ public:
 	void print_statistics();
 
 private:
-	typedef std::set<interval_pointer, Interval> IntervalQueue;
-
 	void update_list_and_queue(list_pointer list,
 							   IntervalWithStop* candidates,	//up to two candidates
 							   unsigned num_candidates);
@@ -315,15 +313,7 @@ inline bool GeodesicAlgorithmExact::erase_from_queue(interval_pointer p)
 {
 	if(p->min() < GEODESIC_INF/10.0)// && p->min >= queue->begin()->first)
 	{
-		assert(m_queue.count(p)<=1);			//the set is unique
-
-		IntervalQueue::iterator it = m_queue.find(p);
-
-		if(it != m_queue.end())
-		{
-			m_queue.erase(it);
-			return true;
-		}
+		return m_queue.erase(p);
 	}
 
 	return false;
@@ -558,8 +548,8 @@ inline void GeodesicAlgorithmExact::propagate(std::vector<SurfacePoint>& sources
 			}
 		}
 
-		interval_pointer min_interval = *m_queue.begin();
-		m_queue.erase(m_queue.begin());
+		interval_pointer min_interval = m_queue.top();
+		m_queue.pop();
 		edge_pointer edge = min_interval->edge();
 		//list_pointer list = interval_list(edge); -Wunused-variable
 
@@ -659,7 +649,7 @@ inline void GeodesicAlgorithmExact::propagate(std::vector<SurfacePoint>& sources
 		} 
 	} 
 
-	m_propagation_distance_stopped = m_queue.empty() ? GEODESIC_INF : (*m_queue.begin())->min();
+	m_propagation_distance_stopped = m_queue.empty() ? GEODESIC_INF : m_queue.top()->min();
 	clock_t stop = clock();
 	m_time_consumed = (static_cast<double>(stop)-static_cast<double>(start))/CLOCKS_PER_SEC;
 
@@ -680,7 +670,7 @@ inline void GeodesicAlgorithmExact::propagate(std::vector<SurfacePoint>& sources
 
 inline bool GeodesicAlgorithmExact::check_stop_conditions(unsigned& index)
 {
-	double queue_distance = (*m_queue.begin())->min();
+	double queue_distance = m_queue.top()->min();
 	if(queue_distance < stop_distance())
 	{
 		return false;
@@ -20,7 +20,9 @@ class Interval						//interval of the edge
 {
 public:
 	
-	Interval(){};
+	Interval():
+		m_queue_position(~0u)
+	{};
 	~Interval(){};
 
 	enum DirectionType
@@ -133,6 +135,7 @@ public:
 	DirectionType& direction(){return m_direction;};
 	bool visible_from_source(){return m_direction == FROM_SOURCE;};
 	unsigned& source_index(){return m_source_index;};
+	unsigned& queue_position(){return m_queue_position;};
 
 	void initialize(edge_pointer edge, 
 					SurfacePoint* point = NULL, 
@@ -149,6 +152,7 @@ protected:
 	edge_pointer m_edge;				//edge that the interval belongs to
 	unsigned m_source_index;			//the source it belongs to
 	DirectionType m_direction;			//where the interval is coming from
+	unsigned m_queue_position;			//index in the IntervalQueue heap, only meaningful while queued
 };
 
 struct IntervalWithStop : public Interval
@@ -159,6 +163,123 @@ protected:
 	double m_stop;
 };
 
+class IntervalQueue			//binary min-heap of intervals, in the order given by Interval::operator()
+{							//every interval keeps its index in the heap, so it can be found and removed without a search
+public:
+	IntervalQueue(){};
+	~IntervalQueue(){};
+
+	bool empty(){return m_heap.empty();};
+	std::size_t size(){return m_heap.size();};
+	interval_pointer top(){return m_heap[0];};
+	void clear(){m_heap.clear();};
+
+	bool contains(interval_pointer p)	//the stored index may be stale (intervals are copied around), so check it
+	{
+		unsigned const i = p->queue_position();
+		return i < m_heap.size() && m_heap[i] == p;
+	}
+
+	void insert(interval_pointer p)		//inserting an interval that is already queued just restores its order
+	{
+		if(contains(p))
+		{
+			update(p);
+			return;
+		}
+		p->queue_position() = m_heap.size();
+		m_heap.push_back(p);
+		sift_up(m_heap.size() - 1);
+	}
+
+	void pop()
+	{
+		remove_at(0);
+	}
+
+	bool erase(interval_pointer p)
+	{
+		if(!contains(p))
+		{
+			return false;
+		}
+		remove_at(p->queue_position());
+		return true;
+	}
+
+	void update(interval_pointer p)		//the key of a queued interval has changed (decrease or increase)
+	{
+		unsigned const i = p->queue_position();
+		sift_down(sift_up(i));
+	}
+
+private:
+	void place(unsigned i, interval_pointer p)
+	{
+		m_heap[i] = p;
+		p->queue_position() = i;
+	}
+
+	unsigned sift_up(unsigned i)
+	{
+		interval_pointer p = m_heap[i];
+		while(i > 0)
+		{
+			unsigned const parent = (i - 1) / 2;
+			if(!m_less(p, m_heap[parent]))
+			{
+				break;
+			}
+			place(i, m_heap[parent]);
+			i = parent;
+		}
+		place(i, p);
+		return i;
+	}
+
+	unsigned sift_down(unsigned i)
+	{
+		interval_pointer p = m_heap[i];
+		unsigned const n = m_heap.size();
+		while(true)
+		{
+			unsigned child = 2*i + 1;
+			if(child >= n)
+			{
+				break;
+			}
+			if(child + 1 < n && m_less(m_heap[child + 1], m_heap[child]))
+			{
+				++child;
+			}
+			if(!m_less(m_heap[child], p))
+			{
+				break;
+			}
+			place(i, m_heap[child]);
+			i = child;
+		}
+		place(i, p);
+		return i;
+	}
+
+	void remove_at(unsigned i)
+	{
+		interval_pointer removed = m_heap[i];
+		interval_pointer last = m_heap.back();
+		m_heap.pop_back();
+		removed->queue_position() = ~0u;
+		if(i < m_heap.size())
+		{
+			place(i, last);
+			sift_down(sift_up(i));
+		}
+	}
+
+	std::vector<interval_pointer> m_heap;
+	Interval m_less;				//Interval::operator() is the ordering
+};
+
 class IntervalList						//list of the of intervals of the given edge
 {
 public:
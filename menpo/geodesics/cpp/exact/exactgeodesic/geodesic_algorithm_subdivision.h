@@ -19,15 +19,15 @@ public:
 	template <class Pointer>
 	SubdivisionNode(Pointer p):
 		SurfacePoint(p),
-		m_previous(NULL),
-		m_distance(0.0)
+		m_distance(0.0),
+		m_previous(NULL)
 	{};
 
 	template <class Pointer, class Parameter>
 	SubdivisionNode(Pointer p, Parameter param):
 		SurfacePoint(p, param),
-		m_previous(NULL),
-		m_distance(0.0)
+		m_distance(0.0),
+		m_previous(NULL)
 	{};
 
 	~SubdivisionNode(){};
@@ -181,7 +181,7 @@ inline void GeodesicAlgorithmSubdivision::list_nodes(MeshElementBase* p,
 	//FACE has no nodes
 }
 
-void GeodesicAlgorithmSubdivision::list_nodes_visible_from_source(MeshElementBase* p,
+inline void GeodesicAlgorithmSubdivision::list_nodes_visible_from_source(MeshElementBase* p,
 																  std::vector<node_pointer>& storage)
 {
 	assert(p->type() != UNDEFINED_POINT);
@@ -207,7 +207,7 @@ void GeodesicAlgorithmSubdivision::list_nodes_visible_from_source(MeshElementBas
 	}
 }
 
-void GeodesicAlgorithmSubdivision::list_nodes_visible_from_node(node_pointer node, //list all nodes that belong to this mesh element
+inline void GeodesicAlgorithmSubdivision::list_nodes_visible_from_node(node_pointer node, //list all nodes that belong to this mesh element
 																std::vector<node_pointer>& storage,
 																std::vector<double>& distances,
 																double threshold_distance)
@@ -78,10 +78,11 @@ public:
 
 	~MemoryAllocator(){};
 
-	void clear()
+	void clear()		//forget all the elements, but keep the blocks for reuse
 	{
-		reset(m_block_size, 
-			  m_max_number_of_blocks);
+		m_current_block = 0;
+		m_current_position = 0;
+		m_deleted.clear();
 	}
 
 	void reset(unsigned block_size, 
@@ -93,6 +94,7 @@ public:
 		assert(m_block_size > 0);
 		assert(m_max_number_of_blocks > 0);
 
+		m_current_block = 0;
 		m_current_position = 0;
 
 		m_storage.reserve(max_number_of_blocks);
@@ -110,11 +112,14 @@ public:
 		{
 			if(m_current_position + 1 >= m_block_size)
 			{
-				m_storage.push_back( std::vector<T>() );
-				m_storage.back().resize(m_block_size);
+				if(++m_current_block == m_storage.size())
+				{
+					m_storage.push_back( std::vector<T>() );
+					m_storage.back().resize(m_block_size);
+				}
 				m_current_position = 0;
 			}
-			result = & m_storage.back()[m_current_position];
+			result = & m_storage[m_current_block][m_current_position];
 			++m_current_position;
 		}
 		else
@@ -138,6 +143,7 @@ private:
 	std::vector<std::vector<T> > m_storage;
 	unsigned m_block_size;				//size of a single block
 	unsigned m_max_number_of_blocks;		//maximum allowed number of blocks
+	unsigned m_current_block;				//block currently being allocated from
 	unsigned m_current_position;			//first unused element inside the current block
 
 	std::vector<pointer> m_deleted;			//pointers to deleted elemets
@@ -1,14 +1,11 @@
 #include "kirsanov_geodesic_wrapper.h"
 
 KirsanovGeodesicWrapper::KirsanovGeodesicWrapper(double* coords, unsigned n_vertices,
-                                unsigned* tri_index, unsigned n_triangles) {
-    for (unsigned i = 0; i < n_vertices*3; i++) {
-        points.push_back(coords[i]);
-    }
-    for (unsigned i = 0; i < n_triangles*3; i++) {
-        faces.push_back(tri_index[i]);
-    }
-    mesh.initialize_mesh_data(points, faces);
+                                unsigned* tri_index, unsigned n_triangles) :
+        exact_algorithms(&mesh),
+        dijkstra_algorithms(&mesh),
+        subdivision_algorithms(&mesh) {
+    mesh.initialize_mesh_data(n_vertices, coords, n_triangles, tri_index);
 }
 
 KirsanovGeodesicWrapper::~KirsanovGeodesicWrapper() { }
@@ -29,30 +26,248 @@ void KirsanovGeodesicWrapper::all_geodesics_from_source_vertices(
     }
 }
 
+unsigned KirsanovGeodesicWrapper::bounded_geodesics_from_source_vertices(
+        geodesic::GeodesicAlgorithmBase* algorithm,
+        unsigned* source_vertices, unsigned n_sources,
+        double max_distance, unsigned* targets, unsigned n_targets,
+        unsigned* indexes, double* phi, unsigned* best_source){
+    std::vector<geodesic::SurfacePoint> all_sources;
+    for (unsigned i = 0; i < n_sources; i++) {
+        all_sources.push_back(
+                geodesic::SurfacePoint(&mesh.vertices()[source_vertices[i]]));
+    }
+    std::vector<geodesic::SurfacePoint> stop_points;
+    for (unsigned i = 0; i < n_targets; i++) {
+        stop_points.push_back(
+                geodesic::SurfacePoint(&mesh.vertices()[targets[i]]));
+    }
+    // the algorithms only stop once they are past the max distance *and*
+    // have covered the stop points, so with no distance given the targets
+    // alone decide when to stop
+    double stop_distance = max_distance;
+    if (n_targets > 0 && max_distance >= geodesic::GEODESIC_INF) {
+        stop_distance = 0.0;
+    }
+    algorithm->propagate(all_sources, stop_distance,
+                         n_targets > 0 ? &stop_points : NULL);
+    // distances the propagation has not settled are reported as
+    // GEODESIC_INF
+    unsigned n_reached = 0;
+    for (unsigned i = 0; i < mesh.vertices().size(); i++) {
+        geodesic::SurfacePoint p(&mesh.vertices()[i]);
+        double distance;
+        unsigned source = algorithm->best_source(p, distance);
+        if (distance <= max_distance && distance < geodesic::GEODESIC_INF) {
+            indexes[n_reached] = i;
+            phi[n_reached] = distance;
+            best_source[n_reached] = source;
+            n_reached++;
+        }
+    }
+    return n_reached;
+}
+
+unsigned KirsanovGeodesicWrapper::bounded_geodesics_from_source_vertices(
+        geodesic::GeodesicAlgorithmBase::AlgorithmType method,
+        unsigned subdivision_level,
+        unsigned* source_vertices, unsigned n_sources,
+        double max_distance, unsigned* targets, unsigned n_targets,
+        unsigned* indexes, double* phi, unsigned* best_source){
+    geodesic::GeodesicAlgorithmBase* algorithm = acquire_algorithm(
+            method, subdivision_level);
+    unsigned n_reached = bounded_geodesics_from_source_vertices(algorithm,
+            source_vertices, n_sources, max_distance, targets, n_targets,
+            indexes, phi, best_source);
+    release_algorithm(algorithm);
+    return n_reached;
+}
+
+void KirsanovGeodesicWrapper::geodesic_paths(
+        geodesic::GeodesicAlgorithmBase::AlgorithmType method,
+        unsigned subdivision_level,
+        unsigned* source_vertices, unsigned n_sources,
+        unsigned* destination_vertices, unsigned n_destinations,
+        std::vector<double>& path_points,
+        std::vector<unsigned>& path_offsets){
+    std::vector<geodesic::SurfacePoint> all_sources;
+    for (unsigned i = 0; i < n_sources; i++) {
+        all_sources.push_back(
+                geodesic::SurfacePoint(&mesh.vertices()[source_vertices[i]]));
+    }
+    std::vector<geodesic::SurfacePoint> destinations;
+    for (unsigned i = 0; i < n_destinations; i++) {
+        destinations.push_back(geodesic::SurfacePoint(
+                &mesh.vertices()[destination_vertices[i]]));
+    }
+    geodesic::GeodesicAlgorithmBase* algorithm = acquire_algorithm(
+            method, subdivision_level);
+    // as in bounded_geodesics_from_source_vertices, a zero distance lets
+    // the destinations alone decide when to stop
+    algorithm->propagate(all_sources, 0.0, &destinations);
+
+    // trace_back only reads the propagated data, so the paths can be found
+    // concurrently
+    std::vector<std::vector<geodesic::SurfacePoint> > paths(n_destinations);
+    #pragma omp parallel for schedule(dynamic, 16)
+    for (long i = 0; i < (long)n_destinations; i++) {
+        algorithm->trace_back(destinations[i], paths[i]);
+    }
+    release_algorithm(algorithm);
+
+    path_offsets.assign(n_destinations + 1, 0);
+    for (unsigned i = 0; i < n_destinations; i++) {
+        path_offsets[i + 1] = path_offsets[i] + paths[i].size();
+    }
+    path_points.resize(3 * (size_t)path_offsets[n_destinations]);
+    #pragma omp parallel for schedule(static)
+    for (long i = 0; i < (long)n_destinations; i++) {
+        // trace_back gives the path from the destination to the source
+        std::vector<geodesic::SurfacePoint>& path = paths[i];
+        double* out = &path_points[0] + 3 * (size_t)path_offsets[i];
+        for (long k = (long)path.size() - 1; k >= 0; k--) {
+            *out++ = path[k].x();
+            *out++ = path[k].y();
+            *out++ = path[k].z();
+        }
+    }
+}
+
+unsigned KirsanovGeodesicWrapper::farthest_point_sampling(
+        geodesic::GeodesicAlgorithmBase::AlgorithmType method,
+        unsigned subdivision_level,
+        unsigned* seeds, unsigned n_seeds, unsigned n_samples,
+        unsigned* samples, double* phi, unsigned* voronoi){
+    const unsigned n_vertices = mesh.vertices().size();
+    geodesic::GeodesicAlgorithmBase* algorithm = acquire_algorithm(
+            method, subdivision_level);
+    // the seeds are propagated together over the whole mesh
+    all_geodesics_from_source_vertices(algorithm, seeds, n_seeds, phi,
+                                       voronoi);
+    unsigned n = 0;
+    for (; n < n_seeds; n++) {
+        samples[n] = seeds[n];
+    }
+
+    std::vector<geodesic::SurfacePoint> source(1);
+    for (; n < n_samples; n++) {
+        unsigned farthest = 0;
+        for (unsigned i = 1; i < n_vertices; i++) {
+            if (phi[i] > phi[farthest]) {
+                farthest = i;
+            }
+        }
+        const double radius = phi[farthest];
+        if (radius <= 0.0) {
+            break;
+        }
+        samples[n] = farthest;
+        geodesic::vertex_pointer sample = &mesh.vertices()[farthest];
+        source[0] = geodesic::SurfacePoint(sample);
+        algorithm->propagate(source, radius);
+
+        // a geodesic is never shorter than the straight line between its
+        // ends (nor are the approximate ones), so the new sample can only
+        // take the vertices that are nearer to it in a straight line than
+        // to their current sample - only those are looked up
+        for (unsigned i = 0; i < n_vertices; i++) {
+            geodesic::vertex_pointer v = &mesh.vertices()[i];
+            if (v->distance(sample) >= phi[i]) {
+                continue;
+            }
+            geodesic::SurfacePoint p(v);
+            double distance;
+            algorithm->best_source(p, distance);
+            // (vertices the bounded propagation didn't reach are INF)
+            if (distance < phi[i]) {
+                phi[i] = distance;
+                voronoi[i] = n;
+            }
+        }
+    }
+    release_algorithm(algorithm);
+    return n;
+}
+
+geodesic::GeodesicAlgorithmBase* KirsanovGeodesicWrapper::acquire_algorithm(
+        geodesic::GeodesicAlgorithmBase::AlgorithmType method,
+        unsigned subdivision_level){
+    if (method == geodesic::GeodesicAlgorithmBase::DIJKSTRA) {
+        return dijkstra_algorithms.acquire();
+    }
+    else if (method == geodesic::GeodesicAlgorithmBase::SUBDIVISION) {
+        geodesic::GeodesicAlgorithmSubdivision* algorithm =
+            subdivision_algorithms.acquire();
+        if (algorithm->subdivision_level() != subdivision_level) {
+            algorithm->set_subdivision_level(subdivision_level);
+        }
+        return algorithm;
+    }
+    return exact_algorithms.acquire();
+}
+
+void KirsanovGeodesicWrapper::release_algorithm(
+        geodesic::GeodesicAlgorithmBase* algorithm){
+    if (algorithm->type() == geodesic::GeodesicAlgorithmBase::DIJKSTRA) {
+        dijkstra_algorithms.release(
+                static_cast<geodesic::GeodesicAlgorithmDijkstra*>(algorithm));
+    }
+    else if (algorithm->type() == geodesic::GeodesicAlgorithmBase::SUBDIVISION) {
+        subdivision_algorithms.release(
+                static_cast<geodesic::GeodesicAlgorithmSubdivision*>(algorithm));
+    }
+    else {
+        exact_algorithms.release(
+                static_cast<geodesic::GeodesicAlgorithmExact*>(algorithm));
+    }
+}
+
 void KirsanovGeodesicWrapper::all_exact_geodesics_from_source_vertices(
         unsigned* source_vertices, unsigned n_sources,
         double* phi, unsigned* best_source){
-    geodesic::GeodesicAlgorithmExact algorithm(&mesh);
-    all_geodesics_from_source_vertices(&algorithm, source_vertices, n_sources,
-            phi, best_source);
-}
-
-// currently importing these two headers causes compiler errors
-// not critical so come back to fix
-
-//void KirsanovGeodesicWrapper::all_dijkstra_geodesics_from_source_vertices(
-//        unsigned* source_vertices, unsigned n_sources,
-//        double* phi, unsigned* best_source){
-//    geodesic::GeodesicAlgorithmDijkstra algorithm(&mesh);
-//    all_geodesics_from_source_vertices(&algorithm, source_vertices, n_sources,
-//            phi, best_source);
-//}
-//
-//void KirsanovGeodesicWrapper::all_subdivision_geodesics_from_source_vertices(
-//        unsigned* source_vertices, unsigned n_sources,
-//        double* phi, unsigned* best_source, unsigned subdivision_level){
-//    geodesic::GeodesicAlgorithmSubdivision algorithm(&mesh, subdivision_level);
-//    all_geodesics_from_source_vertices(&algorithm, source_vertices, n_sources,
-//            phi, best_source);
-//}
-//
+    PooledAlgorithm<geodesic::GeodesicAlgorithmExact> algorithm(
+            exact_algorithms);
+    all_geodesics_from_source_vertices(algorithm.get(), source_vertices,
+            n_sources, phi, best_source);
+}
+
+void KirsanovGeodesicWrapper::exact_geodesic_distance_matrix(
+        unsigned* source_vertices, unsigned n_sources, double* distances){
+    const long n_vertices = mesh.vertices().size();
+    // the solver is taken from the pool for each source (rather than once
+    // per thread), so threads left without a source never create one - the
+    // pool keeps every solver it has made for the wrapper's lifetime
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (long i = 0; i < (long)n_sources; i++) {
+        PooledAlgorithm<geodesic::GeodesicAlgorithmExact> algorithm(
+                exact_algorithms);
+        std::vector<geodesic::SurfacePoint> source(1, geodesic::SurfacePoint(
+                &mesh.vertices()[source_vertices[i]]));
+        algorithm->propagate(source);
+        double* row = distances + i * n_vertices;
+        for (long j = 0; j < n_vertices; j++) {
+            geodesic::SurfacePoint p(&mesh.vertices()[j]);
+            algorithm->best_source(p, row[j]);
+        }
+    }
+}
+
+void KirsanovGeodesicWrapper::all_dijkstra_geodesics_from_source_vertices(
+        unsigned* source_vertices, unsigned n_sources,
+        double* phi, unsigned* best_source){
+    PooledAlgorithm<geodesic::GeodesicAlgorithmDijkstra> algorithm(
+            dijkstra_algorithms);
+    all_geodesics_from_source_vertices(algorithm.get(), source_vertices,
+            n_sources, phi, best_source);
+}
+
+void KirsanovGeodesicWrapper::all_subdivision_geodesics_from_source_vertices(
+        unsigned* source_vertices, unsigned n_sources,
+        double* phi, unsigned* best_source, unsigned subdivision_level){
+    PooledAlgorithm<geodesic::GeodesicAlgorithmSubdivision> algorithm(
+            subdivision_algorithms);
+    if (algorithm->subdivision_level() != subdivision_level) {
+        algorithm->set_subdivision_level(subdivision_level);
+    }
+    all_geodesics_from_source_vertices(algorithm.get(), source_vertices,
+            n_sources, phi, best_source);
+}
@@ -1,15 +1,22 @@
 #pragma once
 
 #include<vector>
-//#include "exactgeodesic/geodesic_algorithm_dijkstra.h"
-//#include "exactgeodesic/geodesic_algorithm_subdivision.h"
+#include "exactgeodesic/geodesic_algorithm_dijkstra.h"
+#include "exactgeodesic/geodesic_algorithm_subdivision.h"
 #include "exactgeodesic/geodesic_algorithm_exact.h"
+#include "algorithm_pool.h"
 
 class KirsanovGeodesicWrapper {
     public:
-        std::vector<double> points;
-        std::vector<unsigned> faces;
+        // built straight from the caller's (n_vertices, 3) coords and
+        // (n_triangles, 3) tri_index buffers, which are not kept
         geodesic::Mesh mesh;
+        // the algorithms are built on first use, and then reused for every
+        // later query on this mesh
+        AlgorithmPool<geodesic::GeodesicAlgorithmExact> exact_algorithms;
+        AlgorithmPool<geodesic::GeodesicAlgorithmDijkstra> dijkstra_algorithms;
+        AlgorithmPool<geodesic::GeodesicAlgorithmSubdivision>
+            subdivision_algorithms;
         KirsanovGeodesicWrapper(double* coords, unsigned n_vertices,
                 unsigned* tri_index, unsigned n_triangles);
         ~KirsanovGeodesicWrapper();
@@ -17,15 +24,80 @@ class KirsanovGeodesicWrapper {
                 geodesic::GeodesicAlgorithmBase* algorithm,
                 unsigned* source_vertices, unsigned n_sources,
                 double* phi, unsigned* best_source);
+        // As all_geodesics_from_source_vertices, but propagation stops
+        // early: once it is further than max_distance from the sources and
+        // all of the (n_targets) target vertices have been reached. Only
+        // the vertices reached within max_distance are written, packed at
+        // the front of indexes, phi and best_source (each of which must
+        // have room for every vertex), and the number of them is returned.
+        unsigned bounded_geodesics_from_source_vertices(
+                geodesic::GeodesicAlgorithmBase* algorithm,
+                unsigned* source_vertices, unsigned n_sources,
+                double max_distance, unsigned* targets, unsigned n_targets,
+                unsigned* indexes, double* phi, unsigned* best_source);
+        unsigned bounded_geodesics_from_source_vertices(
+                geodesic::GeodesicAlgorithmBase::AlgorithmType method,
+                unsigned subdivision_level,
+                unsigned* source_vertices, unsigned n_sources,
+                double max_distance, unsigned* targets, unsigned n_targets,
+                unsigned* indexes, double* phi, unsigned* best_source);
+        // Propagates once from the sources (stopping as soon as every
+        // destination is reached), then traces back the geodesic path to
+        // each destination, in parallel. The paths, each running from the
+        // nearest source to its destination, are concatenated as (x, y, z)
+        // triples in path_points, path i being points path_offsets[i] to
+        // path_offsets[i + 1]. Unreachable destinations get an empty path.
+        void geodesic_paths(
+                geodesic::GeodesicAlgorithmBase::AlgorithmType method,
+                unsigned subdivision_level,
+                unsigned* source_vertices, unsigned n_sources,
+                unsigned* destination_vertices, unsigned n_destinations,
+                std::vector<double>& path_points,
+                std::vector<unsigned>& path_offsets);
+        // Geodesic farthest point sampling. Starting from the seed vertices,
+        // the vertex furthest from all the samples so far is repeatedly
+        // added, until there are n_samples (or every vertex is a sample).
+        // A running distance to the nearest sample (phi) is kept, and each
+        // new sample is only propagated as far as the current maximum of
+        // it - no vertex further than that can get any nearer. Only the
+        // vertices nearer to the new sample in a straight line than to
+        // their current sample are then looked up. Fills
+        // samples (n_samples), and for every vertex the distance to (phi)
+        // and index in samples of (voronoi) its nearest sample, i.e. the
+        // geodesic Voronoi cells. The seeds are always kept, so samples
+        // must hold max(n_samples, n_seeds). Returns the number taken.
+        unsigned farthest_point_sampling(
+                geodesic::GeodesicAlgorithmBase::AlgorithmType method,
+                unsigned subdivision_level,
+                unsigned* seeds, unsigned n_seeds, unsigned n_samples,
+                unsigned* samples, double* phi, unsigned* voronoi);
+        // Take an algorithm of the given type from its pool, and give it
+        // back when the query is done.
+        geodesic::GeodesicAlgorithmBase* acquire_algorithm(
+                geodesic::GeodesicAlgorithmBase::AlgorithmType method,
+                unsigned subdivision_level);
+        void release_algorithm(geodesic::GeodesicAlgorithmBase* algorithm);
         void all_exact_geodesics_from_source_vertices(
                 unsigned* source_vertices, unsigned n_sources, double* phi,
                 unsigned* best_source);
-//        void all_dijkstra_geodesics_from_source_vertices(
-//                unsigned* source_vertices, unsigned n_sources, double* phi,
-//                unsigned* best_source);
-//        void all_subdivision_geodesics_from_source_vertices(
-//                unsigned* source_vertices, unsigned n_sources,
-//                double* phi, unsigned* best_source,
-//                unsigned subdivision_level);
+        // Independent single source propagations from each of the sources,
+        // filling the rows of distances ((n_sources, n_vertices), row i is
+        // the distance of every vertex from source_vertices[i]). The
+        // sources are shared out over threads, each of which runs its own
+        // (pooled) GeodesicAlgorithmExact over the (read only) mesh.
+        void exact_geodesic_distance_matrix(
+                unsigned* source_vertices, unsigned n_sources,
+                double* distances);
+        // Approximate geodesics: Dijkstra along the mesh edges, or along a
+        // graph with subdivision_level extra nodes inserted on every edge
+        // (more accurate, and slower, as the level increases - level 0 is
+        // the same as Dijkstra).
+        void all_dijkstra_geodesics_from_source_vertices(
+                unsigned* source_vertices, unsigned n_sources, double* phi,
+                unsigned* best_source);
+        void all_subdivision_geodesics_from_source_vertices(
+                unsigned* source_vertices, unsigned n_sources,
+                double* phi, unsigned* best_source,
+                unsigned subdivision_level);
 };
 
@@ -0,0 +1,174 @@
+import numpy as np
+from scipy.sparse import csr_matrix, diags
+from menpo.shape.mesh.cpptrimesh import CppTriMesh
+
+
+def _factorise(matrix):
+    r"""
+    Factorises a sparse symmetric positive definite matrix once, returning
+    a function that solves it for one or more (columns of) right hand sides.
+    CHOLMOD's Cholesky factorisation is used when scikits.sparse is
+    installed, otherwise SuperLU's.
+    """
+    try:
+        from scikits.sparse.cholmod import cholesky
+        return cholesky(matrix.tocsc())
+    except ImportError:
+        from scipy.sparse.linalg import splu
+        return splu(matrix.tocsc()).solve
+
+
+class HeatGeodesics(object):
+    r"""
+    Approximate geodesics by the heat method: heat is diffused from the
+    sources for a short time, the normalised (negative) gradient of the heat
+    gives the direction of the geodesics, and the distance is recovered from
+    it by a Poisson solve.
+
+    The cotangent Laplacian and mass matrix are built natively and both
+    linear systems are factorised on construction, so every query is only
+    a pair of back substitutions for each system - far cheaper than exact
+    propagation on large meshes.
+
+    Parameters
+    ----------
+    points : (N, 3) ndarray
+        The cartesian points that make up the mesh
+    trilist : (M, 3) ndarray
+        The triangulation of the given points
+    time_step : float, optional
+        The time heat is diffused for. Larger times give smoother (and less
+        accurate) distances. If ``None``, the square of the mean edge length
+        is used.
+
+    References
+    ----------
+    .. [1] Crane, Keenan, Clarisse Weischedel, and Max Wardetzky.
+        "Geodesics in heat: A new approach to computing distance based on
+        heat flow." ACM Transactions on Graphics (TOG) 32.5 (2013).
+    """
+
+    def __init__(self, points, trilist, time_step=None):
+        points = np.require(points, dtype=np.float64, requirements=['C'])
+        trilist = np.require(trilist, dtype=np.uint32, requirements=['C'])
+        self.n_points = points.shape[0]
+        mesh = CppTriMesh(points, trilist)
+
+        a, b, c = [points[trilist[:, i]] for i in range(3)]
+        normals = np.cross(b - a, c - a)
+        double_areas = np.sqrt(np.sum(normals ** 2, axis=1))
+        valid = double_areas > 0
+        normals[valid] /= double_areas[valid][:, None]
+        self._areas = double_areas / 2.0
+
+        # the (constant) gradient of a linear function over each triangle is
+        # sum_i u_i (N x e_i) / 2A, e_i being the edge opposite vertex i
+        n_tris = trilist.shape[0]
+        scale = np.where(valid, 1.0 / np.where(valid, double_areas, 1.0), 0.0)
+        values = np.empty([n_tris, 3, 3])
+        for i, e in enumerate([c - b, a - c, b - a]):
+            values[:, :, i] = np.cross(normals, e) * scale[:, None]
+        rows = np.repeat(np.arange(3 * n_tris), 3)
+        cols = np.tile(trilist, 3).ravel()
+        self._gradient = csr_matrix((values.ravel(), (rows, cols)),
+                                    shape=(3 * n_tris, self.n_points))
+
+        # mesh.laplacian gives cot(a) + cot(b) per edge, the stiffness matrix
+        # G^T A G of the gradient above is half of that
+        stiffness = mesh.laplacian(weight='cotangent', points=points) * 0.5
+        mass = diags(mesh.reduce_tri_scalar_to_vertices(self._areas / 3.0),
+                     0)
+        if time_step is None:
+            lengths = [np.sqrt(np.sum((q - p) ** 2, axis=1))
+                       for p, q in [(a, b), (b, c), (c, a)]]
+            time_step = np.mean(lengths) ** 2
+        self.time_step = time_step
+        self._solve_heat = _factorise(mass + time_step * stiffness)
+        # the stiffness matrix is singular (constants are in its null space),
+        # a vanishingly small amount of mass pins the solution down
+        self._solve_poisson = _factorise(stiffness + 1e-8 * mass)
+
+    def _solve(self, impulses):
+        r"""
+        The (unshifted) distance from the heat ``impulses``, one column of
+        the (N, K) right hand side at a time.
+        """
+        n_columns = impulses.shape[1]
+        heat = self._solve_heat(impulses)
+        # the geodesics run against the gradient of the heat
+        gradient = (self._gradient * heat).reshape(-1, 3, n_columns)
+        norms = np.sqrt(np.sum(gradient ** 2, axis=1))[:, None, :]
+        direction = -gradient / np.where(norms > 0, norms, 1.0)
+        divergence = self._gradient.T * (
+            direction * self._areas[:, None, None]).reshape(-1, n_columns)
+        return self._solve_poisson(divergence)
+
+    def distances(self, source_indexes):
+        r"""
+        The geodesic distance of all points from each of the given
+        ``source_indexes`` independently. Every source is solved for at
+        once, as a column of the right hand side of each system, so this
+        needs O((N + 3M) S) memory.
+
+        Parameters
+        ----------
+        source_indexes : (S,) list
+            List of indexes to calculate the geodesics from
+
+        Returns
+        -------
+        distances : (N, S) ndarray
+            Column ``i`` is the distance of every point from
+            ``source_indexes[i]``
+        """
+        source_indexes = np.asarray(source_indexes, dtype=np.int64).ravel()
+        n_sources = source_indexes.size
+        impulses = np.zeros([self.n_points, n_sources])
+        impulses[source_indexes, np.arange(n_sources)] = 1.0
+        phi = self._solve(impulses)
+        return phi - phi[source_indexes, np.arange(n_sources)]
+
+    def geodesics(self, source_indexes, best_source=True):
+        r"""
+        The geodesic distance of all points from the nearest of the given
+        ``source_indexes``.
+
+        Heat is diffused from all of the sources at once, so the distance
+        alone is a single back substitution for each system, however many
+        sources there are. Finding the nearest source of each point needs
+        the distance from every source separately (see :meth:`distances`).
+
+        Parameters
+        ----------
+        source_indexes : (S,) list
+            List of indexes to calculate the geodesics from
+        best_source : bool, optional
+            If ``False``, the nearest source isn't found, and only ``phi``
+            is returned.
+
+            Default: ``True``
+
+        Returns
+        -------
+        phi : (N,) ndarray
+            The distance of every point to its nearest source
+        best_source : (N,) uint32 ndarray
+            The index (in ``source_indexes``) of the nearest source to
+            every point. Only if ``best_source`` is ``True``.
+        """
+        source_indexes = np.asarray(source_indexes, dtype=np.int64).ravel()
+        if best_source and source_indexes.size > 1:
+            distances = self.distances(source_indexes)
+            nearest = np.argmin(distances, axis=1).astype(np.uint32)
+            phi = distances[np.arange(self.n_points), nearest]
+            return {'phi': phi, 'best_source': nearest}
+        impulses = np.zeros([self.n_points, 1])
+        impulses[source_indexes, 0] = 1.0
+        phi = self._solve(impulses)[:, 0]
+        # the solution only fixes the gradient, which leaves the sources
+        # close to (but not exactly) level - on average they are put at 0
+        phi -= phi[source_indexes].mean()
+        if not best_source:
+            return {'phi': phi}
+        return {'phi': phi,
+                'best_source': np.zeros(self.n_points, dtype=np.uint32)}
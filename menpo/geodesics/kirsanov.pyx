@@ -1,6 +1,9 @@
 # distutils: language = c++
 # distutils: sources = ./menpo/geodesics/cpp/exact/kirsanov_geodesic_wrapper.cpp
+# distutils: extra_compile_args = -fopenmp
+# distutils: extra_link_args = -fopenmp
 
+from libcpp.vector cimport vector
 import numpy as np
 cimport numpy as np
 import cython
@@ -8,18 +11,44 @@ cimport cython
 
 # externally declare the exact geodesic code
 cdef extern from "./cpp/exact/kirsanov_geodesic_wrapper.h":
+    double GEODESIC_INF "geodesic::GEODESIC_INF"
+
+    cdef enum AlgorithmType "geodesic::GeodesicAlgorithmBase::AlgorithmType":
+        EXACT "geodesic::GeodesicAlgorithmBase::EXACT"
+        DIJKSTRA "geodesic::GeodesicAlgorithmBase::DIJKSTRA"
+        SUBDIVISION "geodesic::GeodesicAlgorithmBase::SUBDIVISION"
+
     cdef cppclass KirsanovGeodesicWrapper:
         KirsanovGeodesicWrapper(double* points, unsigned n_vertices,
                 unsigned* tri_index, unsigned n_triangles) except +
         void all_exact_geodesics_from_source_vertices(unsigned* source_vertices,
                 unsigned n_sources, double* phi, unsigned* best_source)
-        #void all_dijkstra_geodesics_from_source_vertices(
-        #        unsigned* source_vertices, unsigned n_sources, double* phi,
-        #        unsigned* best_source)
-        #void all_subdivision_geodesics_from_source_vertices(
-        #        unsigned* source_vertices, unsigned n_sources,
-        #        double* phi, unsigned* best_source,
-        #        unsigned subdivision_level)
+        unsigned bounded_geodesics_from_source_vertices(
+                AlgorithmType method, unsigned subdivision_level,
+                unsigned* source_vertices, unsigned n_sources,
+                double max_distance, unsigned* targets, unsigned n_targets,
+                unsigned* indexes, double* phi, unsigned* best_source) nogil
+        void geodesic_paths(AlgorithmType method, unsigned subdivision_level,
+                unsigned* source_vertices, unsigned n_sources,
+                unsigned* destination_vertices, unsigned n_destinations,
+                vector[double]& path_points,
+                vector[unsigned]& path_offsets) nogil
+        unsigned farthest_point_sampling(
+                AlgorithmType method, unsigned subdivision_level,
+                unsigned* seeds, unsigned n_seeds, unsigned n_samples,
+                unsigned* samples, double* phi, unsigned* voronoi) nogil
+        void exact_geodesic_distance_matrix(unsigned* source_vertices,
+                unsigned n_sources, double* distances) nogil
+        void all_dijkstra_geodesics_from_source_vertices(
+                unsigned* source_vertices, unsigned n_sources, double* phi,
+                unsigned* best_source)
+        void all_subdivision_geodesics_from_source_vertices(
+                unsigned* source_vertices, unsigned n_sources,
+                double* phi, unsigned* best_source,
+                unsigned subdivision_level)
+
+_METHODS = {'exact': EXACT, 'dijkstra': DIJKSTRA, 'subdivision': SUBDIVISION}
+
 
 cdef class KirsanovGeodesics:
     r"""
@@ -53,32 +82,67 @@ cdef class KirsanovGeodesics:
     def __dealloc__(self):
         del self.kirsanovptr
 
-    def geodesics(self, source_vertices, method='exact'):
+    def geodesics(self, source_vertices, method='exact',
+                  subdivision_level=3, max_distance=None, targets=None):
         r"""
         Calculate the geodesic distance for all points from the
         given ``source_indexes``.
 
         Parameters
         -----------
-        source_vertices : (N,) c-contiguous unsigned ndarray
+        source_vertices : (S,) c-contiguous unsigned ndarray
             List of indexes to calculate the geodesics for
-        method : {'exact'}
-            The method using to calculate the geodesics. Only the 'exact'
-            method is currently supported
+        method : {'exact', 'dijkstra', 'subdivision'}
+            The method using to calculate the geodesics:
+
+            =========== =====================================================
+            exact       the exact geodesics of Surazhsky et al.
+            dijkstra    shortest paths along the edges of the mesh
+            subdivision shortest paths along a graph with
+                        ``subdivision_level`` extra nodes on every edge
+            =========== =====================================================
 
             Default: exact
+        subdivision_level : int, optional
+            The number of nodes inserted on each edge for the 'subdivision'
+            method. Higher levels are more accurate and slower.
+
+            Default: 3
+        max_distance : double, optional
+            If given, propagation stops once it is further than this from
+            the sources, and only the points within it are returned.
+        targets : (T,) c-contiguous unsigned ndarray, optional
+            If given, propagation stops once all of these points have been
+            reached (and, if ``max_distance`` is also given, it has gone
+            past ``max_distance``).
 
         Returns
         -------
-        TODO: document these?
-        phi : UNKNOWN
-        best_source : UNKNOWN
+        phi : (N,) or (R,) float64 ndarray
+            The geodesic distance of every point to its nearest source -
+            or, if ``max_distance`` or ``targets`` are given, of each of the
+            ``R`` points in ``indexes``
+        best_source : (N,) or (R,) uint32 ndarray
+            The index (in ``source_vertices``) of the nearest source to every
+            point, or to each of the points in ``indexes``
+        indexes : (R,) uint32 ndarray
+            Only if ``max_distance`` or ``targets`` are given. The points
+            reached, that ``phi`` and ``best_source`` are given for.
 
         Raises
         -------
         ValueError
-            If the given method is not 'exact'
+            If the given method is not understood
         """
+        if max_distance is not None or targets is not None:
+            if method not in _METHODS:
+                raise ValueError("The '" + `method` + "' method for "
+                                 "calculating geodesics is not understood "
+                                 "(must be 'exact', 'dijkstra' or "
+                                 "'subdivision')")
+            return self._bounded_geodesics(source_vertices, _METHODS[method],
+                                           subdivision_level, max_distance,
+                                           targets)
         cdef np.ndarray[unsigned, ndim=1, mode='c'] np_sources = np.array(
                 source_vertices, dtype=np.uint32)
         cdef np.ndarray[double, ndim=1, mode='c'] phi = np.zeros(
@@ -88,16 +152,213 @@ cdef class KirsanovGeodesics:
         if method == 'exact':
             self.kirsanovptr.all_exact_geodesics_from_source_vertices(
                     &np_sources[0], np_sources.size, &phi[0], &best_source[0])
-        #elif method == 'dijkstra':
-        #    self.kirsanovptr.all_dijkstra_geodesics_from_source_vertices(&np_sources[0],
-        #            np_sources.size, &phi[0], &best_source[0])
-        #elif method == 'subdivision':
-        #    self.kirsanovptr.all_subdivision_geodesics_from_source_vertices(
-        #            &np_sources[0], np_sources.size, &phi[0], &best_source[0], 3)
+        elif method == 'dijkstra':
+            self.kirsanovptr.all_dijkstra_geodesics_from_source_vertices(
+                    &np_sources[0], np_sources.size, &phi[0], &best_source[0])
+        elif method == 'subdivision':
+            self.kirsanovptr.all_subdivision_geodesics_from_source_vertices(
+                    &np_sources[0], np_sources.size, &phi[0], &best_source[0],
+                    subdivision_level)
         else:
             raise ValueError("The '" + `method` + "' method for calculating "
                             "geodesics is not understood "
-                            "(only 'exact' can be used at this time)")
+                            "(must be 'exact', 'dijkstra' or 'subdivision')")
 
         geodesic = {'phi': phi, 'best_source': best_source}
         return geodesic
+
+    def _bounded_geodesics(self, source_vertices, AlgorithmType method,
+                           unsigned subdivision_level, max_distance, targets):
+        cdef np.ndarray[unsigned, ndim=1, mode='c'] np_sources = np.array(
+                source_vertices, dtype=np.uint32)
+        cdef np.ndarray[unsigned, ndim=1, mode='c'] np_targets = np.array(
+                [] if targets is None else targets, dtype=np.uint32).ravel()
+        cdef double c_max_distance = \
+            GEODESIC_INF if max_distance is None else max_distance
+        cdef unsigned* targets_ptr = \
+            &np_targets[0] if np_targets.size > 0 else NULL
+        cdef np.ndarray[unsigned, ndim=1, mode='c'] indexes = np.zeros(
+                [self.n_points], dtype=np.uint32)
+        cdef np.ndarray[double, ndim=1, mode='c'] phi = np.zeros(
+                [self.n_points])
+        cdef np.ndarray[unsigned, ndim=1, mode='c'] best_source = np.zeros(
+                [self.n_points], dtype=np.uint32)
+        cdef unsigned n_reached
+        with nogil:
+            n_reached = self.kirsanovptr.bounded_geodesics_from_source_vertices(
+                    method, subdivision_level, &np_sources[0],
+                    np_sources.size, c_max_distance, targets_ptr,
+                    np_targets.size, &indexes[0], &phi[0], &best_source[0])
+        return {'indexes': indexes[:n_reached].copy(),
+                'phi': phi[:n_reached].copy(),
+                'best_source': best_source[:n_reached].copy()}
+
+    def geodesic_distance_matrix(self, source_vertices):
+        r"""
+        Calculate the exact geodesic distance of all points from each of
+        the given ``source_vertices`` independently.
+
+        Each source is propagated on its own, in parallel, with the GIL
+        released.
+
+        Parameters
+        -----------
+        source_vertices : (S,) c-contiguous unsigned ndarray
+            List of indexes to calculate the geodesics from
+
+        Returns
+        -------
+        distances : (S, N) double ndarray
+            The geodesic distance of every point from each source.
+        """
+        cdef np.ndarray[unsigned, ndim=1, mode='c'] np_sources = np.array(
+                source_vertices, dtype=np.uint32)
+        cdef np.ndarray[double, ndim=2, mode='c'] distances = np.zeros(
+                [np_sources.size, self.n_points])
+        if np_sources.size > 0:
+            with nogil:
+                self.kirsanovptr.exact_geodesic_distance_matrix(
+                        &np_sources[0], np_sources.size, &distances[0, 0])
+        return distances
+
+    def farthest_point_sampling(self, n_samples, seed_vertices,
+                                method='exact', subdivision_level=3):
+        r"""
+        Geodesic farthest point sampling: starting from the
+        ``seed_vertices``, the point furthest from all the samples so far
+        is repeatedly added until there are ``n_samples``.
+
+        Each new sample is only propagated as far as the current furthest
+        distance (no point beyond it can get nearer), with the GIL
+        released.
+
+        Parameters
+        -----------
+        n_samples : int
+            The number of samples to take, including the seeds
+        seed_vertices : (K,) c-contiguous unsigned ndarray
+            List of indexes the sampling starts from (``K >= 1``)
+        method : {'exact', 'dijkstra', 'subdivision'}
+            The method used to calculate the geodesics (see
+            :meth:`geodesics`).
+
+            Default: exact
+        subdivision_level : int, optional
+            The number of nodes inserted on each edge for the 'subdivision'
+            method.
+
+            Default: 3
+
+        Returns
+        -------
+        samples : (S,) unsigned ndarray
+            The indexes of the samples, in the order they were taken. Fewer
+            than ``n_samples`` if every point has been sampled.
+        phi : (N,) double ndarray
+            The geodesic distance of every point to its nearest sample
+        best_source : (N,) unsigned ndarray
+            The index (in ``samples``) of the nearest sample to every
+            point, i.e. the geodesic Voronoi cell it lies in
+
+        Raises
+        -------
+        ValueError
+            If the given method is not understood
+        """
+        if method not in _METHODS:
+            raise ValueError("The '" + `method` + "' method for calculating "
+                             "geodesics is not understood "
+                             "(must be 'exact', 'dijkstra' or 'subdivision')")
+        cdef AlgorithmType c_method = _METHODS[method]
+        cdef unsigned c_subdivision_level = subdivision_level
+        cdef unsigned c_n_samples = n_samples
+        cdef np.ndarray[unsigned, ndim=1, mode='c'] np_seeds = np.array(
+                seed_vertices, dtype=np.uint32).ravel()
+        if np_seeds.size == 0:
+            raise ValueError("At least one seed vertex is needed")
+        cdef np.ndarray[unsigned, ndim=1, mode='c'] samples = np.zeros(
+                [max(c_n_samples, np_seeds.size)], dtype=np.uint32)
+        cdef np.ndarray[double, ndim=1, mode='c'] phi = np.zeros(
+                [self.n_points])
+        cdef np.ndarray[unsigned, ndim=1, mode='c'] best_source = np.zeros(
+                [self.n_points], dtype=np.uint32)
+        cdef unsigned n_taken
+        with nogil:
+            n_taken = self.kirsanovptr.farthest_point_sampling(
+                    c_method, c_subdivision_level, &np_seeds[0],
+                    np_seeds.size, c_n_samples, &samples[0], &phi[0],
+                    &best_source[0])
+        return {'samples': samples[:n_taken].copy(), 'phi': phi,
+                'best_source': best_source}
+
+    def geodesic_paths(self, source_vertices, destination_vertices,
+                       method='exact', subdivision_level=3):
+        r"""
+        Calculate the geodesic path from the nearest of the given
+        ``source_vertices`` to each of the ``destination_vertices``.
+
+        The geodesics are propagated once, then all the paths are traced
+        back in parallel, with the GIL released.
+
+        Parameters
+        -----------
+        source_vertices : (S,) c-contiguous unsigned ndarray
+            List of indexes the paths start from
+        destination_vertices : (D,) c-contiguous unsigned ndarray
+            List of indexes to find the paths to
+        method : {'exact', 'dijkstra', 'subdivision'}
+            The method used to calculate the geodesics (see
+            :meth:`geodesics`).
+
+            Default: exact
+        subdivision_level : int, optional
+            The number of nodes inserted on each edge for the 'subdivision'
+            method.
+
+            Default: 3
+
+        Returns
+        -------
+        path_points : (P, 3) double ndarray
+            The points of all the paths, one after another. Each path runs
+            across the surface from a source to its destination.
+        path_offsets : (D + 1,) unsigned ndarray
+            Path ``i`` is ``path_points[path_offsets[i]:path_offsets[i + 1]]``
+            (empty if the destination could not be reached).
+
+        Raises
+        -------
+        ValueError
+            If the given method is not understood
+        """
+        if method not in _METHODS:
+            raise ValueError("The '" + `method` + "' method for calculating "
+                             "geodesics is not understood "
+                             "(must be 'exact', 'dijkstra' or 'subdivision')")
+        cdef AlgorithmType c_method = _METHODS[method]
+        cdef unsigned c_subdivision_level = subdivision_level
+        cdef np.ndarray[unsigned, ndim=1, mode='c'] np_sources = np.array(
+                source_vertices, dtype=np.uint32)
+        cdef np.ndarray[unsigned, ndim=1, mode='c'] np_destinations = np.array(
+                destination_vertices, dtype=np.uint32)
+        cdef vector[double] path_points
+        cdef vector[unsigned] path_offsets
+        if np_sources.size == 0 or np_destinations.size == 0:
+            return (np.zeros([0, 3]),
+                    np.zeros([np_destinations.size + 1], dtype=np.uint32))
+        with nogil:
+            self.kirsanovptr.geodesic_paths(
+                    c_method, c_subdivision_level,
+                    &np_sources[0], np_sources.size,
+                    &np_destinations[0], np_destinations.size,
+                    path_points, path_offsets)
+        cdef np.ndarray[double, ndim=2, mode='c'] points = np.empty(
+                [path_points.size() // 3, 3])
+        cdef np.ndarray[unsigned, ndim=1, mode='c'] offsets = np.empty(
+                [path_offsets.size()], dtype=np.uint32)
+        cdef size_t i
+        for i in range(path_points.size()):
+            points[i // 3, i % 3] = path_points[i]
+        for i in range(path_offsets.size()):
+            offsets[i] = path_offsets[i]
+        return points, offsets
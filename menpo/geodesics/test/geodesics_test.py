@@ -0,0 +1,188 @@
+import numpy as np
+from numpy.testing import assert_allclose
+from nose.tools import raises
+
+from menpo.geodesics import TriMeshGeodesics
+from menpo.geodesics.test.meshes import grid_mesh, hedgehog_mesh, euclidean
+
+
+def test_distance_matrix_rows_match_single_source_geodesics():
+    points, trilist = grid_mesh()
+    geodesics = TriMeshGeodesics(points, trilist)
+    sources = [0, 17, 40, 80]
+    distances = geodesics.distance_matrix(sources)
+    assert(distances.shape == (len(sources), points.shape[0]))
+    for row, source in zip(distances, sources):
+        assert_allclose(row, geodesics.geodesics([source])['phi'])
+        assert_allclose(row, euclidean(points, source), atol=1e-12)
+
+
+def test_approximate_geodesics_bound_exact():
+    points, trilist = grid_mesh()
+    geodesics = TriMeshGeodesics(points, trilist)
+    exact = geodesics.geodesics([40])['phi']
+    dijkstra = geodesics.geodesics([40], method='dijkstra')['phi']
+    # paths through the graphs are paths over the surface, so can't be
+    # shorter than the geodesics - and the subdivision graph contains the
+    # edge graph, so its paths can't be longer than Dijkstra's
+    assert(np.all(dijkstra >= exact - 1e-12))
+    assert(np.any(dijkstra > exact + 1e-3))
+    for level in [1, 3]:
+        subdivision = geodesics.geodesics([40], method='subdivision',
+                                          subdivision_level=level)['phi']
+        assert(np.all(subdivision >= exact - 1e-12))
+        assert(np.all(subdivision <= dijkstra + 1e-12))
+    level_0 = geodesics.geodesics([40], method='subdivision',
+                                  subdivision_level=0)['phi']
+    assert_allclose(level_0, dijkstra)
+
+
+@raises(ValueError)
+def test_geodesics_unknown_method_raises():
+    points, trilist = grid_mesh()
+    TriMeshGeodesics(points, trilist).geodesics([0], method='fast')
+
+
+def test_bounded_geodesics_match_full_propagation():
+    points, trilist = grid_mesh()
+    geodesics = TriMeshGeodesics(points, trilist)
+    for method in ['exact', 'dijkstra', 'subdivision']:
+        full = geodesics.geodesics([40, 3], method=method)
+        # halfway between two vertex distances, so no vertex is on the edge
+        radius = np.mean(np.sort(full['phi'])[30:32])
+        bounded = geodesics.geodesics([40, 3], method=method,
+                                      max_distance=radius)
+        inside = np.nonzero(full['phi'] <= radius)[0]
+        assert_allclose(bounded['indexes'], inside)
+        assert_allclose(bounded['phi'], full['phi'][inside])
+        assert_allclose(bounded['best_source'], full['best_source'][inside])
+
+
+def test_targets_only_geodesics_stop_at_the_targets():
+    points, trilist = grid_mesh()
+    geodesics = TriMeshGeodesics(points, trilist)
+    exact = geodesics.geodesics([40])['phi']
+    targets = [31, 49]
+    bounded = geodesics.geodesics([40], targets=targets)
+    for target in targets:
+        assert(target in bounded['indexes'])
+        assert_allclose(bounded['phi'][bounded['indexes'] == target],
+                        exact[target])
+    # with no max_distance only the targets decide when to stop, so the
+    # propagation ends long before the far corners of the mesh
+    assert(0 not in bounded['indexes'])
+    assert(bounded['indexes'].size < points.shape[0] // 2)
+
+
+def test_reused_solvers_match_fresh_solvers():
+    points, trilist = grid_mesh()
+    geodesics = TriMeshGeodesics(points, trilist)
+    queries = [dict(source_indexes=[0]),
+               dict(source_indexes=[40, 7], max_distance=0.3),
+               dict(source_indexes=[80, 20]),
+               dict(source_indexes=[80], method='subdivision',
+                    subdivision_level=1),
+               dict(source_indexes=[5, 60], method='subdivision'),
+               dict(source_indexes=[33], method='dijkstra'),
+               dict(source_indexes=[12], method='dijkstra', targets=[70])]
+    # every query runs on the solvers (and memory) left by the ones before
+    for kwargs in queries:
+        reused = geodesics.geodesics(**kwargs)
+        fresh = TriMeshGeodesics(points, trilist).geodesics(**kwargs)
+        assert(sorted(reused) == sorted(fresh))
+        for key in fresh:
+            assert_allclose(reused[key], fresh[key])
+
+
+def test_geodesic_paths_run_from_a_source_to_each_destination():
+    points, trilist = grid_mesh()
+    n_grid = points.shape[0]
+    # plus a separate triangle, that can't be reached from the grid (the
+    # geodesic mesh only asserts that it is connected, and extensions are
+    # built with NDEBUG)
+    points = np.vstack([points, [[2, 0, 0], [3, 0, 0], [2, 1, 0]]])
+    trilist = np.vstack([trilist, np.arange(n_grid, n_grid + 3,
+                                            dtype=np.uint32)])
+    geodesics = TriMeshGeodesics(points, trilist)
+    sources = [0, 80]
+    destinations = [20, 44, 80, n_grid + 1, 67]
+    path_points, path_offsets = geodesics.geodesic_paths(sources,
+                                                         destinations)
+    phi = geodesics.geodesics(sources)['phi']
+
+    assert(path_offsets.shape == (len(destinations) + 1,))
+    assert(path_offsets[0] == 0)
+    assert(path_offsets[-1] == path_points.shape[0])
+    assert(np.all(np.diff(path_offsets.astype(np.int64)) >= 0))
+    for i, destination in enumerate(destinations):
+        path = path_points[path_offsets[i]:path_offsets[i + 1]]
+        if destination >= n_grid:
+            assert(path.shape[0] == 0)
+            continue
+        assert(np.min(np.sum((points[sources] - path[0]) ** 2, axis=1)) <
+               1e-20)
+        assert_allclose(path[-1], points[destination])
+        length = np.sum(np.sqrt(np.sum(np.diff(path, axis=0) ** 2, axis=1)))
+        assert_allclose(length, phi[destination], atol=1e-12)
+
+
+def test_exact_geodesics_on_hedgehog_are_unchanged():
+    # pinned from the exact algorithm as it was with a std::set interval
+    # queue (the indexed heap that replaced it gives bit-identical results)
+    points, trilist = hedgehog_mesh()
+    geodesics = TriMeshGeodesics(points, trilist)
+    vertices = [1, 37, 75, 112, 199, 250, 299]
+    result = geodesics.geodesics([0, 150])
+    assert_allclose(result['phi'][vertices],
+                    [0.994351722832939, 2.26500157484401, 1.07627764241567,
+                     1.68352087865286, 0.336461611083642, 2.57647616824562,
+                     1.79042127943134], rtol=1e-12)
+    assert_allclose(result['best_source'][vertices], [1, 0, 0, 0, 0, 0, 1])
+
+    path, offsets = geodesics.geodesic_paths([0], [299])
+    assert(path.shape == (17, 3))
+    assert_allclose(path[0], points[0])
+    assert_allclose(path[1], [0.325286512668293, -0.264663131165102,
+                              0.885844530956663], rtol=1e-12)
+    assert_allclose(path[-1], points[299])
+    length = np.sum(np.sqrt(np.sum(np.diff(path, axis=0) ** 2, axis=1)))
+    assert_allclose(length, 2.69729746210956, rtol=1e-12)
+
+
+def test_farthest_point_sampling_matches_repeated_full_propagation():
+    # a rumpled grid, squashed and stretched to give long, thin triangles,
+    # over which vertices are reached from the side
+    rng = np.random.RandomState(1)
+    for scale in [0.1, 5]:
+        points, trilist = grid_mesh()
+        points[:, :2] += 0.1 * (rng.rand(points.shape[0], 2) - 0.5)
+        points[:, 2] = 0.1 * rng.rand(points.shape[0])
+        points[:, 0] *= scale
+        check_farthest_point_sampling(points, trilist)
+    check_farthest_point_sampling(*hedgehog_mesh())
+
+
+def check_farthest_point_sampling(points, trilist):
+    geodesics = TriMeshGeodesics(points, trilist)
+    for method in ['exact', 'subdivision']:
+        result = geodesics.farthest_point_sampling(40, method=method)
+        samples = list(result['samples'])
+        assert(samples[0] == 0)
+        # each sample is the furthest point from those before it, found by
+        # propagating from all of them over the whole mesh (near ties are
+        # allowed either way)
+        for k in range(1, len(samples)):
+            phi = geodesics.geodesics(samples[:k], method=method)['phi']
+            assert(phi[samples[k]] >= phi.max() - 1e-12)
+        full = geodesics.geodesics(samples, method=method)
+        assert_allclose(result['phi'], full['phi'], atol=1e-12)
+
+
+def test_farthest_point_sampling_stops_when_every_point_is_a_sample():
+    points, trilist = grid_mesh(n=4)
+    geodesics = TriMeshGeodesics(points, trilist)
+    result = geodesics.farthest_point_sampling(100, seed_indexes=[5, 6])
+    assert_allclose(result['samples'][:2], [5, 6])
+    assert(sorted(result['samples']) == list(range(16)))
+    assert_allclose(result['phi'], 0)
+    assert_allclose(result['samples'][result['best_source']], np.arange(16))
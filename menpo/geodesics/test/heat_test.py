@@ -0,0 +1,77 @@
+import numpy as np
+from numpy.testing import assert_allclose
+
+from menpo.geodesics import TriMeshGeodesics
+from menpo.geodesics.heat import HeatGeodesics
+from menpo.geodesics.test.meshes import grid_mesh, euclidean
+
+
+def test_heat_distances_on_a_flat_grid_are_close_to_euclidean():
+    points, trilist = grid_mesh(n=17)
+    sources = [0, 144, 288]
+    distances = HeatGeodesics(points, trilist).distances(sources)
+    assert(distances.shape == (points.shape[0], len(sources)))
+    for distance, source in zip(distances.T, sources):
+        exact = euclidean(points, source)
+        assert(distance[source] == 0)
+        # the heat method is only first order accurate - it is within a
+        # grid spacing (1/16) of the exact distance everywhere, and within
+        # 10% of it away from the source
+        assert(np.all(np.abs(distance - exact) < 1.0 / 16))
+        far = exact > 0.25
+        assert(np.all(np.abs(distance[far] - exact[far]) < 0.1 * exact[far]))
+
+
+def test_heat_geodesics_are_the_nearest_of_the_distances():
+    points, trilist = grid_mesh(n=17)
+    heat = HeatGeodesics(points, trilist)
+    sources = [10, 144, 270]
+    distances = heat.distances(sources)
+    geodesic = heat.geodesics(sources)
+    best_source = np.argmin(distances, axis=1)
+    assert_allclose(geodesic['best_source'], best_source)
+    assert_allclose(geodesic['phi'],
+                    distances[np.arange(points.shape[0]), best_source])
+    assert_allclose(geodesic['phi'], np.min(distances, axis=1))
+
+
+def test_heat_geodesics_without_best_source_solve_all_sources_at_once():
+    points, trilist = grid_mesh(n=17)
+    heat = HeatGeodesics(points, trilist)
+    sources = [10, 144, 270]
+    geodesic = heat.geodesics(sources, best_source=False)
+    assert(sorted(geodesic) == ['phi'])
+    exact = np.min([euclidean(points, s) for s in sources], axis=0)
+    # the sources come out at slightly different levels when they are
+    # solved together, so this is a little looser than for one source
+    assert(np.all(np.abs(geodesic['phi'] - exact) < 0.1))
+    # with a single source it is just the one column of the distances
+    assert_allclose(heat.geodesics([144], best_source=False)['phi'],
+                    heat.distances([144])[:, 0], atol=1e-12)
+
+
+def test_bounded_heat_geodesics_select_from_the_full_solution():
+    points, trilist = grid_mesh(n=17)
+    geodesics = TriMeshGeodesics(points, trilist)
+    sources = [10, 270]
+    full = geodesics.geodesics(sources, method='heat')
+    assert(sorted(full) == ['best_source', 'phi'])
+    assert_allclose(full['phi'], HeatGeodesics(points, trilist).geodesics(
+        sources)['phi'])
+
+    # halfway between two distances, so no point is on the edge
+    radius = np.mean(np.sort(full['phi'])[60:62])
+    inside = np.nonzero(full['phi'] <= radius)[0]
+    for targets in [None, [0, 288]]:
+        bounded = geodesics.geodesics(sources, method='heat',
+                                      max_distance=radius, targets=targets)
+        assert_allclose(bounded['indexes'], inside)
+        assert_allclose(bounded['phi'], full['phi'][inside])
+        assert_allclose(bounded['best_source'], full['best_source'][inside])
+
+    # the heat method solves over the whole mesh, so with only targets
+    # every point is given
+    bounded = geodesics.geodesics(sources, method='heat', targets=[0, 288])
+    assert_allclose(bounded['indexes'], np.arange(points.shape[0]))
+    assert_allclose(bounded['phi'], full['phi'])
+    assert_allclose(bounded['best_source'], full['best_source'])
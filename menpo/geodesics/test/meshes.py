@@ -0,0 +1,46 @@
+r"""
+The meshes the geodesics tests are run on.
+"""
+import os
+import numpy as np
+
+import menpo.geodesics
+
+
+def grid_mesh(n=9):
+    r"""
+    A jittered n x n grid over the unit square in the z = 0 plane. It is flat
+    and convex, so the exact geodesics are the straight lines between points.
+    """
+    rng = np.random.RandomState(0)
+    r, c = np.meshgrid(np.arange(n), np.arange(n), indexing='ij')
+    points = np.zeros([n * n, 3])
+    points[:, 0] = r.ravel()
+    points[:, 1] = c.ravel()
+    interior = np.all((points[:, :2] > 0) & (points[:, :2] < n - 1), axis=1)
+    points[interior, :2] += 0.4 * (rng.rand(interior.sum(), 2) - 0.5)
+    points /= n - 1
+    v = (r[:-1, :-1] * n + c[:-1, :-1]).ravel()
+    trilist = np.vstack([np.vstack([v, v + n, v + 1]).T,
+                         np.vstack([v + 1, v + n, v + n + 1]).T])
+    return points, np.ascontiguousarray(trilist, dtype=np.uint32)
+
+
+def hedgehog_mesh():
+    r"""
+    The (small, irregular) example mesh that comes with the exact geodesic
+    code.
+    """
+    path = os.path.join(os.path.dirname(menpo.geodesics.__file__), 'cpp',
+                        'exact', 'exactgeodesic', 'hedgehog_mesh.txt')
+    with open(path) as f:
+        n_points, n_tris = [int(x) for x in f.readline().split()]
+        values = np.array(f.read().split(), dtype=np.float64)
+    points = values[:3 * n_points].reshape([n_points, 3])
+    trilist = values[3 * n_points:].reshape([n_tris, 3])
+    return (np.ascontiguousarray(points),
+            np.ascontiguousarray(trilist, dtype=np.uint32))
+
+
+def euclidean(points, index):
+    return np.sqrt(np.sum((points - points[index]) ** 2, axis=1))
@@ -659,7 +659,12 @@ class Image(Vectorizable, Landmarkable, Viewable):
 
             Default: ``False``
         interpolator : 'scipy' or 'c', optional
-            The interpolator that should be used to perform the warp.
+            The interpolator that should be used to perform the warp. Note
+            that bilinear warps with a
+            :class:`menpo.transform.PiecewiseAffine` bypass the interpolator
+            altogether and are carried out triangle by triangle in C, and
+            that a :class:`menpo.transform.ThinPlateSplines` built with a
+            ``max_error`` is approximated on a grid for dense warps.
 
             Default: 'scipy'
         kwargs : dict
@@ -686,12 +691,26 @@ class Image(Vectorizable, Landmarkable, Viewable):
                 "Trying to warp a {}D image with a {}D transform "
                 "(they must match)".format(self.n_dims, transform.n_dims))
 
-        template_points = template_mask.true_indices
-        points_to_sample = transform.apply(template_points).T
-        # we want to sample each channel in turn, returning a vector of sampled
-        # pixels. Store those in a (n_pixels, n_channels) array.
-        sampled_pixel_values = _interpolator(self.pixels, points_to_sample,
-                                             **kwargs)
+        from menpo.transform.piecewiseaffine import PiecewiseAffine
+        # any order but 1 (e.g. the 0 BooleanImage forces) is not bilinear,
+        # whichever interpolator it is meant for
+        bilinear = kwargs.get('order', 1) == 1
+        if interpolator == 'scipy':
+            bilinear &= kwargs.get('mode', 'constant') == 'constant'
+        else:
+            bilinear &= kwargs.get('mode', 'bilinear') == 'bilinear'
+        if isinstance(transform, PiecewiseAffine) and bilinear:
+            # piecewise affine warps are done triangle by triangle in one
+            # pass - no need to apply the transform to every point first
+            sampled_pixel_values = transform.sample_image(self.pixels,
+                                                          template_mask)
+        else:
+            template_points = template_mask.true_indices
+            points_to_sample = transform.apply(template_points).T
+            # we want to sample each channel in turn, returning a vector of
+            # sampled pixels. Store those in a (n_pixels, n_channels) array.
+            sampled_pixel_values = _interpolator(self.pixels,
+                                                 points_to_sample, **kwargs)
         # set any nan values to 0
         sampled_pixel_values[np.isnan(sampled_pixel_values)] = 0
         # build a warped version of the image
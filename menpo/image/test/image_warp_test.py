@@ -1,6 +1,9 @@
 import numpy as np
 from numpy.testing import assert_allclose
-from menpo.transform import Affine
+from nose.tools import raises
+from menpo.transform import Affine, PiecewiseAffine
+from menpo.shape import PointCloud
+from menpo.image import BooleanImage
 import menpo.io as pio
 
 
@@ -55,6 +58,45 @@ def test_cinterp2_warp_multi():
     assert_allclose(warped_im.pixels, rgb_template.pixels)
 
 
+def test_pwa_warp_multi():
+    # a piecewise affine that is just the same translation as above
+    src = PointCloud(np.array([[0., 0.], [99., 0.], [0., 99.], [99., 99.],
+                               [40., 60.]]))
+    tgt = PointCloud(src.points + initial_params[4:])
+    pwa = PiecewiseAffine(src, tgt)
+    # bilinear warps with a PiecewiseAffine are done triangle by triangle
+    warped_im = rgb_image.warp_to(template_mask, pwa)
+    assert(warped_im.shape == rgb_template.shape)
+    assert_allclose(warped_im.pixels, rgb_template.pixels)
+
+
+def test_pwa_warp_boolean_is_not_blended():
+    mask_data = np.zeros([100, 100], dtype=np.bool)
+    mask_data[20:41, 20:41] = True
+    mask = BooleanImage(mask_data)
+    # a fraction of a pixel - blending would spread the mask by one pixel
+    src = PointCloud(np.array([[0., 0.], [99., 0.], [0., 99.], [99., 99.],
+                               [40., 60.]]))
+    pwa = PiecewiseAffine(src, PointCloud(src.points + 0.3))
+    translation = Affine.identity(2).from_vector([0, 0, 0, 0, 0.3, 0.3])
+    template = BooleanImage.blank((100, 100))
+    expected = mask.warp_to(template, translation)
+    warped = mask.warp_to(template, pwa)
+    assert(np.sum(warped.pixels) == 21 * 21)
+    assert_allclose(warped.pixels, expected.pixels)
+
+
+@raises(TypeError)
+def test_pwa_warp_boolean_c_interpolator_raises():
+    # the C interpolator has no order 0 for boolean images - the bilinear
+    # piecewise affine warp mustn't be used in its place
+    src = PointCloud(np.array([[0., 0.], [99., 0.], [0., 99.], [99., 99.],
+                               [40., 60.]]))
+    pwa = PiecewiseAffine(src, PointCloud(src.points + 0.3))
+    template = BooleanImage.blank((100, 100))
+    template.warp_to(template, pwa, interpolator='c')
+
+
 ## TODO: Not 100% on the best way to test this?
 #def test_cinterp2_warp_gray_warp_mask():
 #    target_transform = Affine.identity(2).from_vector(initial_params)
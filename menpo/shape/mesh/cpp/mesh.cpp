@@ -1,92 +1,158 @@
 #include <iostream>
+#include <iomanip>
 #include <vector>
-#include <set>
 #include <algorithm>
 #include <cmath>
+#include <utility>
 #include "mesh.h"
-#include "triangle.h"
-#include "vertex.h"
-#include "halfedge.h"
 
-Mesh::Mesh(unsigned *tri_index, unsigned n_tris_in, unsigned n_vertices_in){
+Mesh::Mesh(unsigned *tri_index, unsigned n_tris_in, unsigned n_vertices_in) {
     n_vertices = n_vertices_in;
     n_triangles = n_tris_in;
-    // set the no. of full/half edges to 0
-    // (on creation halfedges pairs will increment these as suitable)
+    n_halfedges = 3 * n_triangles;
     n_fulledges = 0;
-    n_halfedges = 0;
-    for(unsigned i = 0; i < n_vertices; i++) {
-        vertices.push_back(new Vertex(this, i));
+    halfedge_vertex.assign(tri_index, tri_index + n_halfedges);
+    halfedge_twin.assign(n_halfedges, -1);
+    // counting sort of the halfedges by the vertex they start from
+    vertex_offsets.assign(n_vertices + 1, 0);
+    for (unsigned h = 0; h < n_halfedges; h++) {
+        vertex_offsets[halfedge_vertex[h] + 1]++;
     }
-    for(unsigned i = 0; i < n_triangles; i++) {
-        // get the index into the vertex positions
-        unsigned l = tri_index[i*3    ];
-        unsigned m = tri_index[i*3 + 1];
-        unsigned n = tri_index[i*3 + 2];
-        // build a new triangle passing in the pointers to the vertices it will
-        // be made from (the triangle in it's construction will build edges and
-        // connect them)
-        triangles.push_back(new Triangle(this, i, vertices[l],
-                    vertices[m], vertices[n]));
+    for (unsigned v = 0; v < n_vertices; v++) {
+        vertex_offsets[v + 1] += vertex_offsets[v];
+    }
+    vertex_halfedges.resize(n_halfedges);
+    std::vector<int> fill(vertex_offsets.begin(), vertex_offsets.end() - 1);
+    for (unsigned h = 0; h < n_halfedges; h++) {
+        vertex_halfedges[fill[halfedge_vertex[h]]++] = h;
+    }
+    // the twin of a -> b is b -> a, which is one of the few halfedges
+    // leaving b
+    for (unsigned h = 0; h < n_halfedges; h++) {
+        if (halfedge_twin[h] >= 0) {
+            continue;
+        }
+        const int a = halfedge_vertex[h];
+        const int b = end_vertex(h);
+        for (int k = vertex_offsets[b]; k < vertex_offsets[b + 1]; k++) {
+            const int g = vertex_halfedges[k];
+            if (end_vertex(g) == a && halfedge_twin[g] < 0) {
+                halfedge_twin[h] = g;
+                halfedge_twin[g] = h;
+                n_fulledges++;
+                break;
+            }
+        }
     }
 }
 
-void Mesh::add_edge(HalfEdge* halfedge) {
-    edges.insert(halfedge);
+Mesh::~Mesh() {}
+
+// Calls f(j, h) for every vertex j sharing a triangle with vertex i, where
+// h is a halfedge between i and j (i -> j if there is one, else j -> i).
+// Outgoing halfedges give every neighbour but the one across a boundary
+// halfedge arriving at i, which is picked up from the previous halfedge of
+// the triangle. On a non-manifold or inconsistently oriented mesh a
+// neighbour can be reached through more than one halfedge, and so is
+// visited more than once.
+template <class F>
+static inline void for_each_neighbour(const Mesh &mesh, unsigned i, F &f) {
+    for (int k = mesh.vertex_offsets[i]; k < mesh.vertex_offsets[i + 1]; k++) {
+        const int h = mesh.vertex_halfedges[k];
+        f(mesh.end_vertex(h), h);
+        const int incoming = Mesh::prev(h);
+        if (!mesh.part_of_fulledge(incoming)) {
+            f(mesh.halfedge_vertex[incoming], incoming);
+        }
+    }
+}
+
+struct CollectNeighbours {
+    std::vector<int> neighbours;
+    void operator()(int j, int) { neighbours.push_back(j); }
+};
+
+unsigned Mesh::n_neighbours(unsigned v) const {
+    // neighbours visited more than once are only counted once
+    CollectNeighbours collect;
+    for_each_neighbour(*this, v, collect);
+    std::sort(collect.neighbours.begin(), collect.neighbours.end());
+    return std::unique(collect.neighbours.begin(),
+                       collect.neighbours.end()) - collect.neighbours.begin();
 }
 
 void Mesh::generate_edge_index(unsigned* edge_index) {
-    std::set<HalfEdge*>::iterator he;
+    // one entry per full edge (the lower halfedge of the pair) and per
+    // boundary halfedge
     unsigned count = 0;
-    for(he = edges.begin(); he != edges.end(); he++, count++)
-    {
-        edge_index[count*2]     = (*he)->v0->id;
-        edge_index[count*2 + 1] = (*he)->v1->id;
+    for (unsigned h = 0; h < n_halfedges; h++) {
+        const int twin = halfedge_twin[h];
+        if (twin < 0 || (int)h < twin) {
+            edge_index[count * 2] = halfedge_vertex[h];
+            edge_index[count * 2 + 1] = end_vertex(h);
+            count++;
+        }
     }
 }
 
-Mesh::~Mesh() {
-    triangles.clear();
-    // now all the triangles are clear we're good to delete all the vertices
-    // we initially made
-    vertices.clear();
-}
-
 void Mesh::verify_mesh() {
-    std::vector<Vertex*>::iterator v;
-    for(v = vertices.begin(); v != vertices.end(); v++) {
-        (*v)->verify_halfedge_connectivity();
+    bool pass = true;
+    for (unsigned h = 0; h < n_halfedges; h++) {
+        if (next(next(next(h))) != (int)h) {
+            std::cout << "cannie spin raarnd the triangle like man!"
+                << std::endl;
+            pass = false;
+        }
+        const int twin = halfedge_twin[h];
+        if (twin >= 0 && (halfedge_vertex[twin] != end_vertex(h) ||
+                          end_vertex(twin) != halfedge_vertex[h] ||
+                          halfedge_twin[twin] != (int)h)) {
+            std::cout << "some half edges aren't paired up !" << std::endl;
+            pass = false;
+        }
+    }
+    if (!pass) {
+        std::cout << "HALFEDGE CONNECTIVITY: FAIL" << std::endl;
     }
     test_contiguous();
     test_chiral_consistency();
 }
 
 void Mesh::test_chiral_consistency() {
+    // a consistently oriented mesh never has two halfedges a -> b. If it
+    // does, one of the two triangles has a flipped normal or is a repeat.
     std::cout << "CHIRALCONSISTENCY: ";
-    std::set<HalfEdge*>::iterator edge;
     bool pass = true;
-    unsigned fulledges_encountered = 0;
-    unsigned halfedges_encountered = 0;
-    for (edge = edges.begin(); edge != edges.end(); edge++) {
-        halfedges_encountered++;
-        if ((*edge)->part_of_fulledge()) {
-            fulledges_encountered++;
-            halfedges_encountered++;
-            if ((*edge)->halfedge->v1 != (*edge)->v0 ||
-                    (*edge)->halfedge->v0 != (*edge)->v1) {
-                pass = false;
+    for (unsigned v = 0; v < n_vertices; v++) {
+        for (int k = vertex_offsets[v]; k < vertex_offsets[v + 1]; k++) {
+            for (int l = k + 1; l < vertex_offsets[v + 1]; l++) {
+                const int h = vertex_halfedges[k];
+                const int g = vertex_halfedges[l];
+                if (end_vertex(h) == end_vertex(g)) {
+                    if (pass) {
+                        std::cout << "FAIL" << std::endl;
+                    }
+                    pass = false;
+                    std::cout << "    V" << v << " has a half edge to V" <<
+                        end_vertex(h) << " on both triangle T" <<
+                        triangle(h) << " and triangle T" << triangle(g) <<
+                        std::endl;
+                }
             }
         }
     }
     if (pass) {
         std::cout << "PASS" << std::endl;
     }
-    else {
-        std::cout << "FAIL" << std::endl;
-    }
     std::cout << "EDGECOUNT: ";
+    unsigned fulledges_encountered = 0;
+    for (unsigned h = 0; h < n_halfedges; h++) {
+        if (halfedge_twin[h] > (int)h) {
+            fulledges_encountered++;
+        }
+    }
     if (fulledges_encountered == n_fulledges &&
-            halfedges_encountered == n_halfedges) {
+            halfedge_vertex.size() == n_halfedges) {
         std::cout << "PASS" << std::endl;
     }
     else {
@@ -95,112 +161,274 @@ void Mesh::test_chiral_consistency() {
 }
 
 void Mesh::test_contiguous() {
-    std::vector< std::set<Vertex*> > vertices_per_region = contiguous_regions();
+    std::vector< std::vector<unsigned> > vertices_per_region =
+        contiguous_regions();
     size_t regions_count = vertices_per_region.size();
     std::cout << "Vertices are grouped into " <<
         regions_count << " contiguous region(s)." << std::endl;
     if (regions_count > 1) {
-        size_t largest_region = (*vertices_per_region.begin()).size();
+        size_t largest_region = vertices_per_region[0].size();
         int region_pc= int((100.0 * largest_region) / n_vertices);
         std::cout << "The largest contiguous region acounts for approximatey "
             << region_pc << "\% of the mesh." << std::endl;
     }
 }
 
-bool sort_sets_by_size(const std::set<Vertex*> &a,
-        const std::set<Vertex*> &b) {
+static bool sort_regions_by_size(const std::vector<unsigned> &a,
+        const std::vector<unsigned> &b) {
     return a.size() > b.size();
 }
 
-std::vector< std::set<Vertex*> > Mesh::contiguous_regions() {
-    /* Returns a vector of set's of vertex pointers where each set contains
+struct VisitNeighbours {
+    std::vector<bool> &visited;
+    std::vector<unsigned> &region;
+    VisitNeighbours(std::vector<bool> &visited_in,
+                    std::vector<unsigned> &region_in) :
+        visited(visited_in), region(region_in) {}
+    void operator()(int j, int) {
+        if (!visited[j]) {
+            visited[j] = true;
+            region.push_back(j);
+        }
+    }
+};
+
+std::vector< std::vector<unsigned> > Mesh::contiguous_regions() {
+    /* Returns a vector of vectors of vertex ids where each vector contains
      * vertices that are joined by triangles into a contiguous whole. The
      * vector is sorted s.t. the largest contiguous region is the first.
-     * Note: a set of size one impies that the vertex is not used in any
+     * Note: a region of size one implies that the vertex is not used in any
      * triangle.
      */
-    std::set<Vertex*> vertices_not_visited(
-            vertices.begin(), vertices.end());
-    std::vector< std::set<Vertex*> > vertices_per_region;
-    std::set<Vertex*>::iterator v;
-    while (!vertices_not_visited.empty()) {
-        std::set<Vertex*> vertices_not_visited_before = vertices_not_visited;
-        v = vertices_not_visited.begin();
-        vertices_not_visited.erase(*v);
-        (*v)->test_contiguous(&vertices_not_visited);
-        std::set<Vertex*> vertices_visited;
-        std::set_difference(vertices_not_visited_before.begin(),
-                vertices_not_visited_before.end(),
-                vertices_not_visited.begin(), vertices_not_visited.end(),
-                std::inserter(vertices_visited, vertices_visited.end()));
-        vertices_per_region.push_back(vertices_visited);
+    std::vector<bool> visited(n_vertices, false);
+    std::vector< std::vector<unsigned> > vertices_per_region;
+    for (unsigned start = 0; start < n_vertices; start++) {
+        if (visited[start]) {
+            continue;
+        }
+        visited[start] = true;
+        vertices_per_region.push_back(std::vector<unsigned>(1, start));
+        std::vector<unsigned> &region = vertices_per_region.back();
+        VisitNeighbours visit(visited, region);
+        // region doubles as the breadth first queue
+        for (size_t next_vertex = 0; next_vertex < region.size();
+                next_vertex++) {
+            for_each_neighbour(*this, region[next_vertex], visit);
+        }
     }
     std::sort(vertices_per_region.begin(), vertices_per_region.end(),
-            sort_sets_by_size);
+            sort_regions_by_size);
     return vertices_per_region;
 }
 
-void Mesh::laplacian(unsigned* i_sparse, unsigned* j_sparse,
-        double* v_sparse, LaplacianWeightType weight_type) {
-    // pointers to structures used to define a sparse matrix of doubles
-    // where the k'th value of each array is treated to mean:
-    // sparse_matrix[i_sparse[k]][j_sparse[k]] = v_sparse[k]
-
-    // we expect that the attachments at i_sparse, j_sparse
-    // and v_sparse have already been set to the correct
-    // dimentions before this call
-    // (each should be of length 2*n_halfedges)
-    // the first n_coord entries are the diagonals. => the i'th
-    // value of both i_sparse and j_sparse is just i
-    for(unsigned int i = 0; i < n_vertices; i++) {
-        i_sparse[i] = i;
-        j_sparse[i] = i;
+unsigned Mesh::laplacian_indptr(int* indptr) {
+    // one entry per neighbour and one for the diagonal
+    indptr[0] = 0;
+    #pragma omp parallel for schedule(static)
+    for (long i = 0; i < (long)n_vertices; i++) {
+        indptr[i + 1] = n_neighbours(i) + 1;
     }
-    // set the sparse_pointer to the end of the diagonal elements
-    unsigned sparse_pointer = n_vertices;
-    // now loop through each vertex and call the laplacian method.
-    // This method will populate the sparse matrix arrays with the
-    // position and value that should be assiged to the matrix
-    std::vector<Vertex*>::iterator v;
-    for(v = vertices.begin(); v != vertices.end(); v++) {
-        (*v)->laplacian(i_sparse, j_sparse, v_sparse,
-                sparse_pointer, weight_type);
+    for (unsigned i = 0; i < n_vertices; i++) {
+        indptr[i + 1] += indptr[i];
     }
+    return indptr[n_vertices];
+}
+
+static inline double squared_distance(const double* a, const double* b) {
+    const double d0 = a[0] - b[0];
+    const double d1 = a[1] - b[1];
+    const double d2 = a[2] - b[2];
+    return d0 * d0 + d1 * d1 + d2 * d2;
+}
+
+// the cotangent of the angle at o in the triangle (a, b, o)
+static inline double cotangent_at(const double* a, const double* b,
+                                  const double* o) {
+    const double u[3] = {a[0] - o[0], a[1] - o[1], a[2] - o[2]};
+    const double v[3] = {b[0] - o[0], b[1] - o[1], b[2] - o[2]};
+    const double dot = u[0] * v[0] + u[1] * v[1] + u[2] * v[2];
+    const double c0 = u[1] * v[2] - u[2] * v[1];
+    const double c1 = u[2] * v[0] - u[0] * v[2];
+    const double c2 = u[0] * v[1] - u[1] * v[0];
+    const double cross = sqrt(c0 * c0 + c1 * c1 + c2 * c2);
+    // degenerate triangles contribute nothing
+    return cross > 0 ? dot / cross : 0.0;
+}
+
+typedef std::pair<int, double> LaplacianEntry;
+
+static inline bool column_less(const LaplacianEntry &a,
+                               const LaplacianEntry &b) {
+    return a.first < b.first;
 }
 
-void Mesh::cotangent_laplacian(unsigned* i_sparse, unsigned* j_sparse,
-        double* v_sparse, double* cotangents) {
-    for(unsigned int i = 0; i < n_vertices; i++) {
-        i_sparse[i] = i;
-        j_sparse[i] = i;
+struct LaplacianRow {
+    const Mesh &mesh;
+    const double *points;
+    LaplacianWeightType weight_type;
+    unsigned i;
+    std::vector<LaplacianEntry> entries;
+    LaplacianRow(const Mesh &mesh_in, const double *points_in,
+                 LaplacianWeightType weight_type_in) :
+        mesh(mesh_in), points(points_in), weight_type(weight_type_in),
+        i(0) {}
+    inline double cotangent_opposite(int h) const {
+        return cotangent_at(points + 3 * mesh.halfedge_vertex[h],
+                            points + 3 * mesh.end_vertex(h),
+                            points + 3 * mesh.opposite_vertex(h));
     }
-    unsigned sparse_pointer = n_vertices;
-    std::vector<Vertex*>::iterator v;
-    for(v = vertices.begin(); v != vertices.end(); v++){
-        (*v)->cotangent_laplacian(i_sparse, j_sparse, v_sparse,
-                sparse_pointer, cotangents);
+    void operator()(int j, int h) {
+        double w_ij = 1;
+        switch (weight_type) {
+            case combinatorial:
+                break;
+            case distance:
+                w_ij = 1.0 / squared_distance(points + 3 * i,
+                                              points + 3 * j);
+                break;
+            case cotangent:
+                w_ij = cotangent_opposite(h);
+                if (mesh.part_of_fulledge(h)) {
+                    w_ij += cotangent_opposite(mesh.halfedge_twin[h]);
+                }
+                break;
+        }
+        entries.push_back(LaplacianEntry(j, -w_ij));
+    }
+};
+
+void Mesh::laplacian(const double* points, LaplacianWeightType weight_type,
+        const int* indptr, int* indices, double* data) {
+    #pragma omp parallel
+    {
+        // the entries of the row being filled, reused between rows
+        LaplacianRow row(*this, points, weight_type);
+        #pragma omp for schedule(dynamic, 1024)
+        for (long i = 0; i < (long)n_vertices; i++) {
+            row.i = i;
+            row.entries.clear();
+            for_each_neighbour(*this, i, row);
+            std::sort(row.entries.begin(), row.entries.end(), column_less);
+            // a neighbour visited more than once (see for_each_neighbour)
+            // is merged into one entry. Each visit is through a different
+            // triangle, so its cotangents are summed, but the other weights
+            // only depend on the two vertices and are taken once.
+            size_t n_entries = 0;
+            for (size_t e = 0; e < row.entries.size(); e++) {
+                if (n_entries > 0 &&
+                        row.entries[n_entries - 1].first ==
+                        row.entries[e].first) {
+                    if (weight_type == cotangent) {
+                        row.entries[n_entries - 1].second +=
+                            row.entries[e].second;
+                    }
+                } else {
+                    row.entries[n_entries++] = row.entries[e];
+                }
+            }
+            row.entries.resize(n_entries);
+            double diagonal = 0;
+            for (size_t k = 0; k < row.entries.size(); k++) {
+                diagonal -= row.entries[k].second;
+            }
+            const LaplacianEntry diagonal_entry(i, diagonal);
+            row.entries.insert(std::lower_bound(row.entries.begin(),
+                                                row.entries.end(),
+                                                diagonal_entry, column_less),
+                               diagonal_entry);
+            int k = indptr[i];
+            for (size_t e = 0; e < row.entries.size(); e++, k++) {
+                indices[k] = row.entries[e].first;
+                data[k] = row.entries[e].second;
+            }
+        }
     }
 }
 
 void Mesh::reduce_tri_scalar_per_vertex_to_vertices(
-        double* triangle_scalar_per_vertex, double* vertex_scalar) {
-    // this one is for when we have a scalar value defined at each vertex of each triangle
-    std::vector<Triangle*>::iterator t;
-    for(t = triangles.begin(); t != triangles.end(); t++)
-        (*t)->reduce_scalar_per_vertex_to_vertices(triangle_scalar_per_vertex, vertex_scalar);
+        const double* triangle_scalar_per_vertex, unsigned n_channels,
+        double* vertex_scalar) {
+    // this one is for when we have a scalar value defined at each vertex of
+    // each triangle - halfedge h starts at the (h % 3)'th vertex of its
+    // triangle, so the scalar and halfedge arrays line up. Every corner of
+    // a vertex is exactly one of its outgoing halfedges, so each vertex
+    // gathers from its own halfedges and no two threads write to the same
+    // output row.
+    const int n_verts = n_vertices;
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for (int v = 0; v < n_verts; v++) {
+        double* out = vertex_scalar + (size_t)v * n_channels;
+        for (unsigned k = 0; k < n_channels; k++) {
+            out[k] = 0.0;
+        }
+        for (int i = vertex_offsets[v]; i < vertex_offsets[v + 1]; i++) {
+            const double* in = triangle_scalar_per_vertex +
+                (size_t)vertex_halfedges[i] * n_channels;
+            #pragma omp simd
+            for (unsigned k = 0; k < n_channels; k++) {
+                out[k] += in[k];
+            }
+        }
+    }
 }
 
-void Mesh::reduce_tri_scalar_to_vertices(double* triangle_scalar, double* vertex_scalar) {
-    // this one is for when we have a scalar value defined at each triangle and needs to be
-    // applied to each vertex
-    std::vector<Triangle*>::iterator t;
-    for(t = triangles.begin(); t != triangles.end(); t++)
-        (*t)->reduce_scalar_to_vertices(triangle_scalar, vertex_scalar);
+void Mesh::reduce_tri_scalar_to_vertices(const double* triangle_scalar,
+        unsigned n_channels, double* vertex_scalar) {
+    // this one is for when we have a scalar value defined at each triangle
+    // and needs to be applied to each vertex - gathered per vertex from
+    // the triangles of its outgoing halfedges, as above
+    const int n_verts = n_vertices;
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for (int v = 0; v < n_verts; v++) {
+        double* out = vertex_scalar + (size_t)v * n_channels;
+        for (unsigned k = 0; k < n_channels; k++) {
+            out[k] = 0.0;
+        }
+        for (int i = vertex_offsets[v]; i < vertex_offsets[v + 1]; i++) {
+            const double* in = triangle_scalar +
+                (size_t)triangle(vertex_halfedges[i]) * n_channels;
+            #pragma omp simd
+            for (unsigned k = 0; k < n_channels; k++) {
+                out[k] += in[k];
+            }
+        }
+    }
 }
 
-
-MeshAttribute::MeshAttribute(Mesh* mesh_in, unsigned id_in) {
-    mesh = mesh_in;
-    id = id_in;
+void Mesh::vertex_status(unsigned v) {
+    std::cout << "V" << v << std::endl;
+    for (int k = vertex_offsets[v]; k < vertex_offsets[v + 1]; k++) {
+        const int h = vertex_halfedges[k];
+        std::cout << "|" << (part_of_fulledge(h) ? "=" : "-");
+        std::cout << "V" << end_vertex(h);
+        std::cout << " (T" << triangle(h);
+        if (part_of_fulledge(h)) {
+            std::cout << "=T" << triangle(halfedge_twin[h]);
+        }
+        std::cout << ")" << std::endl;
+    }
 }
 
+void Mesh::triangle_status(unsigned t) {
+    std::cout << "    TRIANGLE " << t << "        " << std::endl;
+    unsigned width = 12;
+    for (unsigned k = 0; k < 3; k++) {
+        const int h = 3 * t + k;
+        std::cout << std::setw(width) << "V" << k << "(" <<
+            halfedge_vertex[h] << ")";
+        std::cout << (part_of_fulledge(h) ? "============" : "------------");
+    }
+    std::cout << std::setw(width) << "V0(" << halfedge_vertex[3 * t] << ")"
+        << std::endl;
+    for (unsigned k = 0; k < 3; k++) {
+        const int h = 3 * t + k;
+        std::cout << std::setw(width) << " ";
+        if (part_of_fulledge(h)) {
+            std::cout << std::setw(width) << triangle(halfedge_twin[h]);
+        }
+        else {
+            std::cout << " -- ";
+        }
+    }
+    std::cout << std::endl;
+}
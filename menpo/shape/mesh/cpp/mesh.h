@@ -1,40 +1,50 @@
 #pragma once
 
 #include <vector>
-#include <set>
 
-class Triangle;
-class Vertex;
-class HalfEdge;
+// The weight w_ij given to each edge (i, j) of a Laplacian:
+//   combinatorial - 1
+//   distance      - 1 / ||p_i - p_j||^2
+//   cotangent     - cot(a_ij) + cot(b_ij), the angles opposite the edge on
+//                   the (up to two) triangles sharing it
+enum LaplacianWeightType {combinatorial, distance, cotangent};
 
-enum LaplacianWeightType {combinatorial, distance};
-
-// C++ class layer built on top of simple C data arrays. Mesh is composed
-// of triangles, halfedges, and vertices, each of which is a light C++ class
-// containing pointers to neighbours. This allows for algorithms to be written
-// in C++/Cython that can efficiently loop over the triangle structure. The
-// actual organisation of the data itself is not delt with by this framework
-// - it simply works on pointers to C style arrays passed into the methods
-// defined on this class. This makes it very easy to efficiently interface
-// to this framework from python/matlab without having to perform copies
-// everytime we want to run an algorithm.
+// Flat, index-based halfedge structure built on top of a simple C triangle
+// list. Every triangle t owns the three halfedges 3t, 3t + 1 and 3t + 2,
+// where halfedge 3t + k runs from the k'th to the (k + 1)'th vertex of t
+// (CCW). With that numbering the next halfedge around a triangle and the
+// triangle of a halfedge are implicit (see next() and triangle()), and the
+// only per-element storage is a handful of contiguous int arrays:
+//
+//   halfedge_vertex[h]  - the vertex halfedge h starts from (the trilist)
+//   halfedge_twin[h]    - the opposite halfedge, or -1 on the boundary
+//   vertex_halfedges[vertex_offsets[v] : vertex_offsets[v + 1]]
+//                       - every halfedge starting from vertex v
+//
+// These are built in O(n_triangles): a counting sort of the halfedges by
+// the vertex they start from, then for each halfedge a search through the
+// (few) halfedges leaving its end vertex for its twin.
 //
-// Triangles and vertices both have an unsigned 'id' field that can be safely
-// used to index into arrays. Array arguments follow a structure to identify
-// their required size:
+// The mesh only describes connectivity - the actual organisation of the
+// data itself is not dealt with by this framework, it simply works on
+// pointers to C style arrays passed into the methods defined on this class.
+// This makes it very easy to efficiently interface to this framework from
+// python/matlab without having to perform copies every time we want to run
+// an algorithm. Array arguments follow a structure to identify their
+// required size:
 //    double* t_vector_field
 //            ^   ^
 //    one entry    3 values (x,y,z) per entry
 //    per Tri
 //                                                => shape = [n_triangles, 3]
 //
-// and on the 342'nd Triangle, this.id = 341, so
+// and on the 342'nd triangle, t = 341, so
 //
-//   x = t_vector_field[this.id*3 + 0]
-//   y = t_vector_field[this.id*3 + 1]
-//   z = t_vector_field[this.id*3 + 2]
+//   x = t_vector_field[t*3 + 0]
+//   y = t_vector_field[t*3 + 1]
+//   z = t_vector_field[t*3 + 2]
 //
-// are the relevent entries in the array.
+// are the relevant entries in the array.
 //
 // Note that this framework expects all arrays to be allocated to the
 // correct size before method invocation!
@@ -44,42 +54,61 @@ class Mesh
     public:
         Mesh(unsigned *tri_index, unsigned n_triangles, unsigned n_vertices);
         ~Mesh();
-        // pointer to an array dim(n_verticesx3) containing the coordinates
-        // for each vertex of the mesh
         unsigned n_vertices;
         unsigned n_triangles;
+        // halfedges with a twin are counted in n_fulledges once per pair
         unsigned n_fulledges;
         unsigned n_halfedges;
-        // storage for the c++ objects for each triangle and vertex
-        std::vector<Triangle*> triangles;
-        std::vector<Vertex*> vertices;
-        std::set<HalfEdge*> edges;
+        std::vector<int> halfedge_vertex;
+        std::vector<int> halfedge_twin;
+        std::vector<int> vertex_offsets;
+        std::vector<int> vertex_halfedges;
+
+        // the implicit halfedge topology
+        static inline int next(int h) { return h - h % 3 + (h + 1) % 3; }
+        static inline int prev(int h) { return h - h % 3 + (h + 2) % 3; }
+        static inline int triangle(int h) { return h / 3; }
+        inline int end_vertex(int h) const { return halfedge_vertex[next(h)]; }
+        inline int opposite_vertex(int h) const {
+            return halfedge_vertex[prev(h)];
+        }
+        inline bool part_of_fulledge(int h) const {
+            return halfedge_twin[h] >= 0;
+        }
+        // the number of distinct vertices sharing a triangle with v
+        unsigned n_neighbours(unsigned v) const;
 
-        void add_edge(HalfEdge* halfedge);
         void generate_edge_index(unsigned* edgeIndex);
 
-        void laplacian(unsigned* i_sparse, unsigned* j_sparse,
-                double*   v_sparse, LaplacianWeightType weight_type);
-        void cotangent_laplacian(unsigned* i_sparse, unsigned* j_sparse,
-                double*   v_sparse, double* cotangents_per_vertex);
-        void reduce_tri_scalar_to_vertices(double* triangle_scalar,
-                double* vertex_scalar);
+        // The Laplacian L (L_ii = sum_j w_ij, L_ij = -w_ij) assembled
+        // directly in CSR form, with the columns of each row sorted and
+        // unique.
+        // laplacian_indptr fills indptr (n_vertices + 1) and returns the
+        // number of non-zeros, which indices and data must be allocated
+        // for before calling laplacian. points is (n_vertices, 3) and is
+        // only read for the distance and cotangent weights (the weights
+        // are computed from it as each row is filled). Rows are filled in
+        // parallel.
+        unsigned laplacian_indptr(int* indptr);
+        void laplacian(const double* points, LaplacianWeightType weight_type,
+                const int* indptr, int* indices, double* data);
+        // Sum n_channels values defined on each triangle
+        // ((n_triangles, n_channels)), or on each vertex of each triangle
+        // ((n_triangles, 3, n_channels)), onto the vertices. vertex_scalar
+        // ((n_vertices, n_channels)) is overwritten. Each vertex gathers
+        // from its own outgoing halfedges, so vertices are reduced in
+        // parallel without any two threads writing to the same output.
+        void reduce_tri_scalar_to_vertices(const double* triangle_scalar,
+                unsigned n_channels, double* vertex_scalar);
         void reduce_tri_scalar_per_vertex_to_vertices(
-                double* triangle_scalar_per_vertex, double* vertex_scalar);
+                const double* triangle_scalar_per_vertex, unsigned n_channels,
+                double* vertex_scalar);
 
         // utilities
         void verify_mesh();
         void test_contiguous();
-        std::vector< std::set<Vertex*> > contiguous_regions();
+        std::vector< std::vector<unsigned> > contiguous_regions();
         void test_chiral_consistency();
+        void vertex_status(unsigned v);
+        void triangle_status(unsigned t);
 };
-
-
-class MeshAttribute
-{
-    public:
-        Mesh *mesh;
-        unsigned id;
-        MeshAttribute(Mesh* mesh, unsigned id);
-};
-
@@ -0,0 +1,129 @@
+#include <cmath>
+#include <cfloat>
+#include <stdint.h>
+#include <vector>
+#include "normals.h"
+
+namespace {
+
+inline void subtract(const double* a, const double* b, double* out) {
+    out[0] = a[0] - b[0];
+    out[1] = a[1] - b[1];
+    out[2] = a[2] - b[2];
+}
+
+inline void cross(const double* x, const double* y, double* out) {
+    out[0] = x[1] * y[2] - x[2] * y[1];
+    out[1] = x[2] * y[0] - x[0] * y[2];
+    out[2] = x[0] * y[1] - x[1] * y[0];
+}
+
+inline double dot(const double* x, const double* y) {
+    return x[0] * y[0] + x[1] * y[1] + x[2] * y[2];
+}
+
+// the length of v, or 1 if v is too short to safely divide by
+inline double safe_norm(const double* v) {
+    const double norm = std::sqrt(dot(v, v));
+    return norm < DBL_EPSILON ? 1.0 : norm;
+}
+
+template <typename F, typename I>
+inline void load_point(const F* points, const I* trilist, size_t corner,
+                       double* out) {
+    const F* p = points + 3 * static_cast<size_t>(trilist[corner]);
+    out[0] = p[0];
+    out[1] = p[1];
+    out[2] = p[2];
+}
+
+}  // namespace
+
+template <typename F, typename I>
+void compute_mesh_normals(const F* points, size_t n_points,
+                          const I* trilist, size_t n_triangles,
+                          NormalWeighting weighting,
+                          F* vertex_normals, F* face_normals) {
+    const long n_tris = static_cast<long>(n_triangles);
+    const long n_verts = static_cast<long>(n_points);
+    // the unnormalised face normals (|n| = twice the triangle area) are
+    // kept around for the vertex pass
+    std::vector<double> face_cross(3 * n_triangles);
+
+    #pragma omp parallel for schedule(static)
+    for (long t = 0; t < n_tris; t++) {
+        double a[3], b[3], c[3], ab[3], ac[3];
+        load_point(points, trilist, 3 * t, a);
+        load_point(points, trilist, 3 * t + 1, b);
+        load_point(points, trilist, 3 * t + 2, c);
+        subtract(b, a, ab);
+        subtract(c, a, ac);
+        double* n = &face_cross[3 * t];
+        cross(ab, ac, n);
+        const double norm = safe_norm(n);
+        for (int d = 0; d < 3; d++)
+            face_normals[3 * t + d] = static_cast<F>(n[d] / norm);
+    }
+
+    // vertex -> triangle corner index (corner 3t + k is the k'th vertex of
+    // triangle t), built by a counting sort of the corners by vertex
+    std::vector<size_t> offsets(n_points + 1, 0);
+    for (size_t c = 0; c < 3 * n_triangles; c++)
+        offsets[static_cast<size_t>(trilist[c]) + 1]++;
+    for (size_t v = 0; v < n_points; v++)
+        offsets[v + 1] += offsets[v];
+    std::vector<size_t> corners(3 * n_triangles);
+    {
+        std::vector<size_t> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t c = 0; c < 3 * n_triangles; c++)
+            corners[fill[static_cast<size_t>(trilist[c])]++] = c;
+    }
+
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for (long v = 0; v < n_verts; v++) {
+        double sum[3] = {0.0, 0.0, 0.0};
+        for (size_t i = offsets[v]; i < offsets[v + 1]; i++) {
+            const size_t c = corners[i];
+            const size_t t = c / 3;
+            const double* n = &face_cross[3 * t];
+            double weight;
+            if (weighting == AREA) {
+                // |n| is already proportional to the area
+                weight = 1.0;
+            } else {
+                weight = 1.0 / safe_norm(n);
+                if (weighting == ANGLE) {
+                    double p[3], q[3], r[3], pq[3], pr[3];
+                    load_point(points, trilist, c, p);
+                    load_point(points, trilist, t * 3 + (c + 1) % 3, q);
+                    load_point(points, trilist, t * 3 + (c + 2) % 3, r);
+                    subtract(q, p, pq);
+                    subtract(r, p, pr);
+                    double pq_x_pr[3];
+                    cross(pq, pr, pq_x_pr);
+                    weight *= std::atan2(std::sqrt(dot(pq_x_pr, pq_x_pr)),
+                                         dot(pq, pr));
+                }
+            }
+            sum[0] += weight * n[0];
+            sum[1] += weight * n[1];
+            sum[2] += weight * n[2];
+        }
+        const double norm = safe_norm(sum);
+        for (int d = 0; d < 3; d++)
+            vertex_normals[3 * v + d] = static_cast<F>(sum[d] / norm);
+    }
+}
+
+#define INSTANTIATE_NORMALS(F, I) \
+    template void compute_mesh_normals<F, I>( \
+            const F*, size_t, const I*, size_t, NormalWeighting, F*, F*);
+
+INSTANTIATE_NORMALS(float, int32_t)
+INSTANTIATE_NORMALS(float, int64_t)
+INSTANTIATE_NORMALS(float, uint32_t)
+INSTANTIATE_NORMALS(float, uint64_t)
+INSTANTIATE_NORMALS(double, int32_t)
+INSTANTIATE_NORMALS(double, int64_t)
+INSTANTIATE_NORMALS(double, uint32_t)
+INSTANTIATE_NORMALS(double, uint64_t)
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stddef.h>
+
+// How the normals of the triangles around a vertex are combined into the
+// vertex normal:
+//   UNIFORM - every triangle counts equally (the unit face normals are summed)
+//   AREA    - each triangle is weighted by its area
+//   ANGLE   - each triangle is weighted by its interior angle at the vertex
+enum NormalWeighting { UNIFORM, AREA, ANGLE };
+
+// Computes the unit normal of every triangle and of every vertex of a
+// triangle mesh. points is (n_points, 3), trilist is (n_triangles, 3) and
+// the outputs vertex_normals ((n_points, 3)) and face_normals
+// ((n_triangles, 3)) must be allocated by the caller. Normals shorter than
+// machine epsilon (degenerate triangles, unreferenced vertices) are left
+// unnormalised rather than divided by ~0.
+//
+// The work is split in two parallel passes: one over the triangles for the
+// face normals, and one over the vertices, each of which sums the weighted
+// normals of the triangles around it. The triangles around each vertex are
+// found from a (counting sorted) vertex -> triangle corner index, so every
+// thread only writes to the vertices it owns - there are no atomics or
+// per-thread buffers to reduce.
+//
+// Instantiated for float and double points with int32, int64, uint32 and
+// uint64 triangle lists. All arithmetic is done in double.
+template <typename F, typename I>
+void compute_mesh_normals(const F* points, size_t n_points,
+                          const I* trilist, size_t n_triangles,
+                          NormalWeighting weighting,
+                          F* vertex_normals, F* face_normals);
@@ -1,9 +1,9 @@
 # distutils: language = c++
-# distutils: sources = ./menpo/shape/mesh/cpp/mesh.cpp ./menpo/shape/mesh/cpp/vertex.cpp ./menpo/shape/mesh/cpp/halfedge.cpp ./menpo/shape/mesh/cpp/triangle.cpp
+# distutils: sources = ./menpo/shape/mesh/cpp/mesh.cpp
+# distutils: extra_compile_args = -fopenmp
+# distutils: extra_link_args = -fopenmp
 
 from libcpp.vector cimport vector
-from libcpp.set cimport set
-from cython.operator cimport dereference as deref, preincrement as inc
 import numpy as np
 cimport numpy as np
 import cython
@@ -12,49 +12,44 @@ cimport cython
 class MeshConstructionError(Exception):
     pass
 
-# externally declare the C++ Mesh, Vertex, Triangle and HalfEdge classes
+# externally declare the C++ Mesh class
 cdef extern from "./cpp/mesh.h":
+    cdef enum LaplacianWeightType:
+        combinatorial
+        distance
+        cotangent
+
     cdef cppclass Mesh:
         Mesh(unsigned *tri_index, unsigned n_tris, unsigned n_points) except +
         unsigned n_vertices
         unsigned n_triangles
         unsigned n_halfedges
         unsigned n_fulledges
-        vector[Vertex*] vertices
-        vector[Triangle*] triangles
-        vector[HalfEdge*] halfedges
-        void laplacian(unsigned* i_sparse, unsigned* j_sparse,
-                double* v_sparse)
-        void cotangent_laplacian(unsigned* i_sparse, unsigned* j_sparse,
-                double* v_sparse, double* cotangent_weights)
+        vector[int] halfedge_vertex
+        vector[int] halfedge_twin
+        vector[int] vertex_offsets
+        vector[int] vertex_halfedges
+        unsigned laplacian_indptr(int* indptr)
+        void laplacian(const double* points, LaplacianWeightType weight_type,
+                const int* indptr, int* indices, double* data) nogil
         void verify_mesh()
         void generate_edge_index(unsigned* edgeIndex)
         void reduce_tri_scalar_to_vertices(
-                double* triangle_scalar, double* vertex_scalar)
+                const double* triangle_scalar, unsigned n_channels,
+                double* vertex_scalar) nogil
         void reduce_tri_scalar_per_vertex_to_vertices(
-                double* triangle_scalar_p_vert, double* vertex_scalar)
-
-    cdef enum LaplacianWeightType:
-        combinatorial
-        distance
-
-cdef extern from "./cpp/vertex.h":
-    cdef cppclass Vertex:
-        set[HalfEdge*] halfedges
-        void status()
-
-cdef extern from "./cpp/triangle.h":
-    cdef cppclass Triangle:
-        void status()
-
-cdef extern from "./cpp/halfedge.h":
-    cdef cppclass HalfEdge:
-        pass
+                const double* triangle_scalar_p_vert, unsigned n_channels,
+                double* vertex_scalar) nogil
+        void vertex_status(unsigned v)
+        void triangle_status(unsigned t)
 
 # Wrap the Mesh class to produce CppTriMesh
 # TODO: document me
 cdef class CppTriMesh:
     cdef Mesh* thisptr
+    # the points the mesh was built with, used when no other points are
+    # available (subclasses such as FastTriMesh keep their own .points)
+    cdef object _points
 
     def __cinit__(self, points,
             np.ndarray[unsigned, ndim=2, mode="c"] trilist not None):
@@ -64,6 +59,7 @@ cdef class CppTriMesh:
                                         ")")
         self.thisptr = new Mesh(&trilist[0,0], trilist.shape[0],
                                 points.shape[0])
+        self._points = points
 
     def __dealloc__(self):
         del self.thisptr
@@ -83,27 +79,175 @@ cdef class CppTriMesh:
     def verify_mesh(self):
         self.thisptr.verify_mesh()
 
+    def laplacian(self, weight='combinatorial', points=None):
+        r"""
+        The Laplacian of the mesh, :math:`L_{ii} = \sum_j w_{ij}`,
+        :math:`L_{ij} = -w_{ij}` for every edge :math:`(i, j)`.
+
+        Parameters
+        ----------
+        weight : {'combinatorial', 'distance', 'cotangent'}, optional
+            The weight given to each edge:
+
+            ============== ===============================================
+            combinatorial  :math:`1`
+            distance       :math:`1 / \lVert p_i - p_j \rVert^2`
+            cotangent      :math:`\cot \alpha_{ij} + \cot \beta_{ij}`,
+                           the angles opposite the edge on the (up to two)
+                           triangles sharing it
+            ============== ===============================================
+
+            Default: 'combinatorial'
+        points : (n_points, 3) ndarray, optional
+            The vertex positions the weights are computed from. If ``None``
+            the mesh's own points are used.
+
+        Returns
+        -------
+        laplacian : (n_points, n_points) :class:`scipy.sparse.csr_matrix`
+            The Laplacian, with the columns of each row sorted.
+
+        Raises
+        ------
+        ValueError
+            If the weight is unknown or the points do not match the mesh
+        """
+        weight_types = {'combinatorial': combinatorial,
+                        'distance': distance,
+                        'cotangent': cotangent}
+        if weight not in weight_types:
+            raise ValueError("Don't understand weight '{}': needs to be one "
+                             "of {}".format(weight, sorted(weight_types)))
+        if points is None:
+            points = getattr(self, 'points', self._points)
+        if points.shape != (self.thisptr.n_vertices, 3):
+            raise ValueError("points must be ({}, 3)".format(
+                self.thisptr.n_vertices))
+        return self._laplacian(points, weight_types[weight])
+
+    def _laplacian(self, points, LaplacianWeightType weight_type):
+        r"""
+        Assembles the Laplacian with the given edge weighting directly in
+        CSR form (rows filled in parallel, weights computed from
+        ``points`` on the fly) and wraps the arrays, without copying, as a
+        :class:`scipy.sparse.csr_matrix`.
+        """
+        from scipy.sparse import csr_matrix
+        cdef unsigned n = self.thisptr.n_vertices
+        cdef np.ndarray[double, ndim=2, mode='c'] p = np.require(
+            points, dtype=np.float64, requirements=['C'])
+        cdef np.ndarray[int, ndim=1, mode='c'] indptr = np.zeros(
+            n + 1, dtype=np.int32)
+        cdef unsigned nnz = self.thisptr.laplacian_indptr(&indptr[0])
+        cdef np.ndarray[int, ndim=1, mode='c'] indices = np.empty(
+            nnz, dtype=np.int32)
+        cdef np.ndarray[double, ndim=1, mode='c'] data = np.empty(nnz)
+        if nnz > 0:
+            with nogil:
+                self.thisptr.laplacian(&p[0, 0], weight_type, &indptr[0],
+                                       &indices[0], &data[0])
+        return csr_matrix((data, indices, indptr), shape=(n, n), copy=False)
+
+    @property
+    def halfedge_twin(self):
+        r"""
+        The opposite halfedge of each halfedge, ``-1`` on the boundary.
+        Halfedge ``3 * t + k`` runs from the ``k``'th to the
+        ``(k + 1) % 3``'th vertex of triangle ``t``.
+
+        :type: (``n_tris * 3``,) int32 ndarray
+        """
+        cdef np.ndarray[int, ndim=1, mode='c'] twin = np.empty(
+            self.thisptr.n_halfedges, dtype=np.int32)
+        cdef unsigned h
+        for h in range(self.thisptr.n_halfedges):
+            twin[h] = self.thisptr.halfedge_twin[h]
+        return twin
+
+    @property
+    def edge_index(self):
+        r"""
+        The vertex indices of each (undirected) edge of the mesh.
+
+        :type: (``n_edges``, 2) uint32 ndarray
+        """
+        cdef np.ndarray[unsigned, ndim=2, mode='c'] edges = np.empty(
+            [self.n_edges, 2], dtype=np.uint32)
+        if self.n_edges > 0:
+            self.thisptr.generate_edge_index(&edges[0, 0])
+        return edges
+
     def vertex_status(self, n_vertex):
         assert 0 <= n_vertex < self.thisptr.n_vertices
-        deref(self.thisptr.vertices[n_vertex]).status()
+        self.thisptr.vertex_status(n_vertex)
 
     def tri_status(self, n_triangle):
         assert 0 <= n_triangle < self.thisptr.n_triangles
-        deref(self.thisptr.triangles[n_triangle]).status()
-
-    def reduce_tri_scalar_per_vertex_to_vertices(self,
-            np.ndarray[double, ndim=2, mode="c"] tri_s not None):
-        cdef np.ndarray[double, ndim=1, mode='c'] vert_s = \
-            np.zeros(self.thisptr.n_vertices)
-        self.thisptr.reduce_tri_scalar_per_vertex_to_vertices(
-            &tri_s[0,0], &vert_s[0])
-        return vert_s
-
-    def reduce_tri_scalar_to_vertices(self,
-            np.ndarray[double, ndim=1, mode="c"] triangle_scalar not None):
+        self.thisptr.triangle_status(n_triangle)
+
+    def reduce_tri_scalar_per_vertex_to_vertices(self, tri_s):
+        r"""
+        Sums a field defined on each vertex of each triangle onto the
+        vertices of the mesh.
+
+        Parameters
+        ----------
+        tri_s : (n_tris, 3) or (n_tris, 3, K) ndarray
+            The value(s) at each corner of each triangle. Any number of
+            channels ``K`` are reduced at once.
+
+        Returns
+        -------
+        vertex_scalar : (n_points,) or (n_points, K) ndarray
+            The sum of the values of every corner at each vertex.
+        """
+        tri_s = np.asarray(tri_s)
+        if tri_s.shape[:2] != (self.thisptr.n_triangles, 3) or tri_s.ndim > 3:
+            raise ValueError("tri_s must be ({0}, 3) or ({0}, 3, K)".format(
+                self.thisptr.n_triangles))
+        return self._reduce(tri_s, True)
+
+    def reduce_tri_scalar_to_vertices(self, triangle_scalar):
+        r"""
+        Sums a field defined on each triangle onto the vertices of the mesh.
+
+        Parameters
+        ----------
+        triangle_scalar : (n_tris,) or (n_tris, K) ndarray
+            The value(s) on each triangle. Any number of channels ``K`` are
+            reduced at once.
+
+        Returns
+        -------
+        vertex_scalar : (n_points,) or (n_points, K) ndarray
+            The sum of the values of the triangles around each vertex.
+        """
+        triangle_scalar = np.asarray(triangle_scalar)
+        if (triangle_scalar.shape[:1] != (self.thisptr.n_triangles,) or
+                triangle_scalar.ndim > 2):
+            raise ValueError("triangle_scalar must be ({0},) or ({0}, "
+                             "K)".format(self.thisptr.n_triangles))
+        return self._reduce(triangle_scalar, False)
+
+    def _reduce(self, field, bint per_vertex):
+        r"""
+        Runs the (parallel) reduction of a per-triangle (or per triangle
+        vertex) field, treating any trailing axis as channels.
+        """
+        channel_shape = field.shape[2:] if per_vertex else field.shape[1:]
+        cdef unsigned n_channels = int(np.prod(channel_shape))
+        cdef np.ndarray[double, ndim=1, mode='c'] c_field = np.require(
+            field, dtype=np.float64, requirements=['C']).ravel()
         cdef np.ndarray[double, ndim=1, mode='c'] vertex_scalar = \
-            np.zeros(self.thisptr.n_vertices)
-        self.thisptr.reduce_tri_scalar_to_vertices(&triangle_scalar[0],
-            &vertex_scalar[0])
-        return vertex_scalar
+            np.zeros(self.thisptr.n_vertices * n_channels)
+        if vertex_scalar.size > 0 and c_field.size > 0:
+            with nogil:
+                if per_vertex:
+                    self.thisptr.reduce_tri_scalar_per_vertex_to_vertices(
+                        &c_field[0], n_channels, &vertex_scalar[0])
+                else:
+                    self.thisptr.reduce_tri_scalar_to_vertices(
+                        &c_field[0], n_channels, &vertex_scalar[0])
+        return vertex_scalar.reshape((self.thisptr.n_vertices,) +
+                                     channel_shape)
 
@@ -1,110 +1,102 @@
+# distutils: language = c++
+# distutils: sources = ./menpo/shape/mesh/cpp/normals.cpp
+# distutils: extra_compile_args = -fopenmp
+# distutils: extra_link_args = -fopenmp
+
 import numpy as np
-import cython
 cimport numpy as np
 cimport cython
 
-ctypedef np.float64_t FLOAT64_T
+ctypedef fused floats:
+    np.float32_t
+    np.float64_t
+
 ctypedef fused integrals:
     np.uint32_t
     np.uint64_t
     np.int32_t
     np.int64_t
 
-cdef np.ndarray[FLOAT64_T, ndim=2] normalise(np.ndarray[FLOAT64_T, ndim=2] vec):
-    """
-    Normalise the given array of vectors.
-
-    Parameters
-    ----------
-    vec : (N, 3) c-contiguous double ndarray
-        The array of vectors to normalise
-
-    Returns
-    -------
-    normalised : (N, 3) c-contiguous double ndarray
-        Normalised array of vectors.
-    """
-    # Avoid divisions by almost 0 numbers
-    # np.spacing(1) is equivalent to Matlab's eps
-    cdef np.ndarray[FLOAT64_T, ndim=1] d = np.sqrt(np.sum(vec ** 2, axis=1))
-    d[d < np.spacing(1)] = 1.0
-    return vec / d[..., None]
-
+cdef extern from "./cpp/normals.h":
+    cdef enum NormalWeighting:
+        UNIFORM
+        AREA
+        ANGLE
 
-cdef inline np.ndarray[FLOAT64_T, ndim=2] cross(double[:, :] x,
-                                                double[:, :] y):
-    """
-    The N x 3 cross product (returns the vectors orthogonal
-    to ``x`` and ``y``). This performs the cross product on each (3, 1) vector
-    in the two arrays. Assumes ``x`` and ``y`` have the same shape.
+    void compute_mesh_normals[F, I](const F* points, size_t n_points,
+                                    const I* trilist, size_t n_triangles,
+                                    NormalWeighting weighting,
+                                    F* vertex_normals, F* face_normals) nogil
 
-    Parameters
-    ----------
-    x : (N, 3) double memory view
-        First array to perform cross product with.
-    y : (N, 3) double memory view
-        Second array to perform cross product with.
 
-    Returns
-    -------
-    cross : (N, 3) c-contiguous double ndarray
-        The array of vectors representing the cross product between each
-        corresponding vector.
-    """
-    cdef np.ndarray[FLOAT64_T, ndim=2] z = np.empty_like(x)
-    cdef int n = x.shape[0]
-    for i in range(n):
-        z[i, 0] = x[i, 1] * y[i, 2] - x[i, 2] * y[i, 1]
-        z[i, 1] = x[i, 2] * y[i, 0] - x[i, 0] * y[i, 2]
-        z[i, 2] = x[i, 0] * y[i, 1] - x[i, 1] * y[i, 0]
+_WEIGHTINGS = {'uniform': UNIFORM, 'area': AREA, 'angle': ANGLE}
 
-    return z
 
-
-cpdef compute_normals(np.ndarray[FLOAT64_T, ndim=2] vertex,
-                      np.ndarray[integrals, ndim=2] face):
+cpdef compute_normals(np.ndarray[floats, ndim=2] vertex,
+                      np.ndarray[integrals, ndim=2] face,
+                      weighting='uniform'):
     """
     Compute the per-vertex and per-face normal of the vertices given a list of
     faces. Ensures that all the normals are pointing in a consistent direction
     (to avoid 'inverted' normals).
 
+    The face normals are computed and gathered to the vertices natively, in
+    parallel.
+
     Parameters
     ----------
-    vertex : (N, 3) c-contiguous double ndarray
+    vertex : (N, 3) float32 or float64 ndarray
         The list of points to compute normals for.
-    face : (M, 3) c-contiguous double ndarray
+    face : (M, 3) int32, int64, uint32 or uint64 ndarray
         The list of faces (triangle list).
+    weighting : {'uniform', 'area', 'angle'}, optional
+        How the normals of the faces around a vertex are combined:
+
+        ======= ===========================================================
+        uniform every face counts equally
+        area    each face is weighted by its area
+        angle   each face is weighted by its interior angle at the vertex
+        ======= ===========================================================
+
+        Default: 'uniform'
 
     Returns
     -------
-    vertex_normal : (N, 3) c-contiguous double ndarray
-        The normal per vertex.
-    face_normal : (M, 3) c-contiguous double ndarray
-        The normal per face.
-    :return:
+    vertex_normal : (N, 3) c-contiguous ndarray
+        The normal per vertex, of the same dtype as ``vertex``.
+    face_normal : (M, 3) c-contiguous ndarray
+        The normal per face, of the same dtype as ``vertex``.
+
+    Raises
+    ------
+    ValueError
+        If the weighting is unknown, or a face indexes a vertex that
+        doesn't exist
     """
-    cdef int nface = face.shape[0]
-    cdef int nvert = vertex.shape[0]
-
-    # Calculate the cross product (per-face normal)
-    cdef np.ndarray[FLOAT64_T, ndim=2] face_normal = cross(
-        vertex[face[:, 1], :] - vertex[face[:, 0], :],
-        vertex[face[:, 2], :] - vertex[face[:, 0], :])
-    face_normal = normalise(face_normal)
-
-    # Calculate per-vertex normal
-    cdef np.ndarray[FLOAT64_T, ndim=2] vertex_normal = np.zeros([nvert, 3])
-    cdef int f0, f1, f2
-    for i in range(nface):
-        f0 = face[i, 0]
-        f1 = face[i, 1]
-        f2 = face[i, 2]
-        for j in range(3):
-            vertex_normal[f0, j] += face_normal[i, j]
-            vertex_normal[f1, j] += face_normal[i, j]
-            vertex_normal[f2, j] += face_normal[i, j]
-
-    # Normalize
-    vertex_normal = normalise(vertex_normal)
-
+    if weighting not in _WEIGHTINGS:
+        raise ValueError("Don't understand weighting '{}': needs to be one "
+                         "of {}".format(weighting, sorted(_WEIGHTINGS)))
+    cdef NormalWeighting c_weighting = _WEIGHTINGS[weighting]
+    cdef np.ndarray[floats, ndim=2, mode='c'] c_vertex = \
+        np.ascontiguousarray(vertex)
+    cdef np.ndarray[integrals, ndim=2, mode='c'] c_face = \
+        np.ascontiguousarray(face)
+    cdef size_t nvert = c_vertex.shape[0]
+    cdef size_t nface = c_face.shape[0]
+    # the native gather indexes with the faces unchecked
+    if nface > 0 and (c_face.min() < 0 or c_face.max() >= nvert):
+        raise ValueError("The faces index vertices outside of the {} "
+                         "given".format(nvert))
+
+    cdef np.ndarray[floats, ndim=2, mode='c'] vertex_normal = np.zeros(
+        [nvert, 3], dtype=vertex.dtype)
+    cdef np.ndarray[floats, ndim=2, mode='c'] face_normal = np.zeros(
+        [nface, 3], dtype=vertex.dtype)
+    if nvert == 0 or nface == 0:
+        return vertex_normal, face_normal
+
+    with nogil:
+        compute_mesh_normals(&c_vertex[0, 0], nvert, &c_face[0, 0], nface,
+                             c_weighting, &vertex_normal[0, 0],
+                             &face_normal[0, 0])
     return vertex_normal, face_normal
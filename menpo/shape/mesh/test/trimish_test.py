@@ -1,6 +1,8 @@
 import numpy as np
 from numpy.testing import assert_allclose
-from menpo.shape import TriMesh
+from nose.tools import raises
+from menpo.shape import TriMesh, FastTriMesh
+from menpo.shape.mesh.normals import compute_normals
 
 
 def test_trimesh_creation():
@@ -77,3 +79,134 @@ def test_trimesh_vertex_normals():
     trimesh = TriMesh(points, trilist)
     vertex_normals = trimesh.vertex_normals
     assert_allclose(vertex_normals, expected_normals)
+
+
+def test_compute_normals_area_weighted_float32():
+    points = np.array([[0.0, 0.0, -1.0],
+                       [1.0, 0.0, 0.0],
+                       [1.0, 1.0, 0.0],
+                       [0.0, 1.0, 0.0]], dtype=np.float32)
+    trilist = np.array([[0, 1, 3],
+                        [1, 2, 3]], dtype=np.int64)
+    # the unnormalised face normals are (-1, -1, 1) and (0, 0, 1), so the
+    # shared vertices are normalise((-1, -1, 2))
+    expected_normals = np.array([[-np.sqrt(3)/3, -np.sqrt(3)/3, np.sqrt(3)/3],
+                                 [-1/np.sqrt(6), -1/np.sqrt(6), 2/np.sqrt(6)],
+                                 [0, 0, 1],
+                                 [-1/np.sqrt(6), -1/np.sqrt(6), 2/np.sqrt(6)]])
+    vertex_normals, face_normals = compute_normals(points, trilist,
+                                                   weighting='area')
+    assert(vertex_normals.dtype == np.float32)
+    assert_allclose(vertex_normals, expected_normals, rtol=1e-6)
+
+
+@raises(ValueError)
+def test_compute_normals_face_index_too_large_raises():
+    points = np.array([[0, 0, 0],
+                       [1, 0, 0],
+                       [1, 1, 0],
+                       [0, 1, 0]], dtype=np.float64)
+    trilist = np.array([[0, 1, 3],
+                        [1, 2, 4]], dtype=np.uint32)
+    compute_normals(points, trilist)
+
+
+@raises(ValueError)
+def test_compute_normals_negative_face_index_raises():
+    points = np.array([[0, 0, 0],
+                       [1, 0, 0],
+                       [1, 1, 0],
+                       [0, 1, 0]], dtype=np.float64)
+    trilist = np.array([[0, 1, 3],
+                        [1, 2, -1]], dtype=np.int64)
+    compute_normals(points, trilist)
+
+
+def test_fasttrimesh_halfedges():
+    points = np.array([[0, 0, 0],
+                       [1, 0, 0],
+                       [1, 1, 0],
+                       [0, 1, 0]], dtype=np.float64)
+    trilist = np.array([[0, 1, 3],
+                        [1, 2, 3]], dtype=np.uint32)
+    mesh = FastTriMesh(points, trilist)
+    assert(mesh.n_halfedges == 6)
+    assert(mesh.n_fulledges == 1)
+    assert(mesh.n_edges == 5)
+    # 1 -> 3 on the first triangle is the twin of 3 -> 1 on the second
+    assert_allclose(mesh.halfedge_twin, [-1, 5, -1, -1, -1, 1])
+    edges = set(tuple(sorted(e)) for e in mesh.edge_index)
+    assert(edges == set([(0, 1), (1, 3), (0, 3), (1, 2), (2, 3)]))
+
+
+def test_fasttrimesh_laplacian():
+    points = np.array([[0, 0, 0],
+                       [1, 0, 0],
+                       [1, 1, 0],
+                       [0, 1, 0]], dtype=np.float64)
+    trilist = np.array([[0, 1, 3],
+                        [1, 2, 3]], dtype=np.uint32)
+    mesh = FastTriMesh(points, trilist)
+    combinatorial = np.array([[2, -1, 0, -1],
+                              [-1, 3, -1, -1],
+                              [0, -1, 2, -1],
+                              [-1, -1, -1, 3]])
+    assert_allclose(mesh.laplacian().toarray(), combinatorial)
+    # both angles opposite the diagonal are right angles (cot = 0), every
+    # other edge is opposite a 45 degree angle (cot = 1)
+    cotangent = np.array([[2, -1, 0, -1],
+                          [-1, 2, -1, 0],
+                          [0, -1, 2, -1],
+                          [-1, 0, -1, 2]])
+    assert_allclose(mesh.laplacian(weight='cotangent').toarray(), cotangent,
+                    atol=1e-12)
+    distance = mesh.laplacian(weight='distance').toarray()
+    assert_allclose(distance[1, 3], -0.5)
+    assert_allclose(distance.sum(axis=1), 0, atol=1e-12)
+
+
+def test_fasttrimesh_reduce_multiple_channels():
+    points = np.array([[0, 0, 0],
+                       [1, 0, 0],
+                       [1, 1, 0],
+                       [0, 1, 0]], dtype=np.float64)
+    trilist = np.array([[0, 1, 3],
+                        [1, 2, 3]], dtype=np.uint32)
+    mesh = FastTriMesh(points, trilist)
+    triangle_field = np.array([[1.0, 10.0],
+                               [2.0, 20.0]])
+    assert_allclose(mesh.reduce_tri_scalar_to_vertices(triangle_field),
+                    [[1, 10], [3, 30], [2, 20], [3, 30]])
+    assert_allclose(mesh.reduce_tri_scalar_to_vertices(triangle_field[:, 0]),
+                    [1, 3, 2, 3])
+    corner_field = np.arange(12, dtype=np.float64).reshape(2, 3, 2)
+    assert_allclose(mesh.reduce_tri_scalar_per_vertex_to_vertices(
+        corner_field), [[0, 1], [2 + 6, 3 + 7], [8, 9], [4 + 10, 5 + 11]])
+
+
+def test_fasttrimesh_laplacian_flipped_triangle():
+    points = np.array([[0, 0, 0],
+                       [1, 0, 0],
+                       [1, 1, 0],
+                       [0, 1, 0]], dtype=np.float64)
+    # the second triangle is wound the wrong way, so both triangles have a
+    # halfedge 1 -> 3 and the diagonal is reached twice from 1 and from 3
+    trilist = np.array([[0, 1, 3],
+                        [1, 3, 2]], dtype=np.uint32)
+    mesh = FastTriMesh(points, trilist)
+    laplacian = mesh.laplacian()
+    for i in range(4):
+        row = laplacian.indices[laplacian.indptr[i]:laplacian.indptr[i + 1]]
+        assert(len(set(row)) == len(row))
+    combinatorial = np.array([[2, -1, 0, -1],
+                              [-1, 3, -1, -1],
+                              [0, -1, 2, -1],
+                              [-1, -1, -1, 3]])
+    assert_allclose(laplacian.toarray(), combinatorial)
+    # the diagonal's cotangents are summed over both triangles: 0 for the
+    # right angle at 0, and 3 / 4 at 2 once it is moved out to (1.5, 1.5)
+    points[2] = [1.5, 1.5, 0]
+    cotangent = mesh.laplacian(weight='cotangent', points=points).toarray()
+    assert_allclose(cotangent[1, 3], -0.75)
+    assert_allclose(cotangent[3, 1], -0.75)
+    assert_allclose(cotangent.sum(axis=1), 0, atol=1e-12)
@@ -4,6 +4,7 @@ from menpo.base import Targetable, Vectorizable
 from menpo.model.pdm import PDM, GlobalPDM, OrthoPDM
 
 from .base import Transform, VComposable, VInvertible
+from .piecewiseaffine.fastpwa import weighted_sum_of_triangle_vertex_values
 
 
 class ModelDrivenTransform(Transform, Targetable, Vectorizable,
@@ -244,25 +245,82 @@ class ModelDrivenTransform(Transform, Targetable, Vectorizable,
         dW/dp : (N, P, D) ndarray
             The Jacobian of the ModelDrivenTransform evaluated at the
             previous points.
+
+        Notes
+        -----
+        dW/dX is cached on ``dW_dX`` for the given points, in the form
+        :meth:`_weight_points` gives it.
         """
         # check if re-computation of dW/dx can be avoided
         if not np.array_equal(self._cached_points, points):
             # recompute dW/dx, i.e. the relative weight of each point wrt
             # the source landmarks
-            self.dW_dX = self.transform.weight_points(points)
+            self.dW_dX = self._weight_points(points)
             # cache points
             self._cached_points = points
 
         # dX/dp is simply the Jacobian of the model
         dX_dp = self.pdm.model.jacobian
 
-        # dW_dX:    n_points   x    n_points    x  n_dims
-        # dX_dp:  n_points  x     n_params      x  n_dims
-        dW_dp = np.einsum('ild, lpd -> ipd', self.dW_dX, dX_dp)
+        dW_dp = self._dW_dp_from_dX_dp(dX_dp)
         # dW_dp:    n_points   x     n_params      x  n_dims
 
         return dW_dp
 
+    def _weight_points(self, points):
+        r"""
+        The relative weight of each point wrt the source landmarks (dW/dX).
+        Transforms that can provide this in a sparse form (piecewise affine)
+        do so, as the dense form is almost entirely zeros.
+
+        Parameters
+        -----------
+        points : (N, D) ndarray
+            The points to weight.
+
+        Returns
+        -------
+        dW/dX : (N, L, D) ndarray or tuple
+            The dense weights or, if the transform provides
+            ``weight_points_sparse``, a ``(vertex_index, weights)`` tuple of
+            two (N, 3) ndarrays - the three source points each point depends
+            on and its weight wrt each of them. :meth:`_dW_dp_from_dX_dp`
+            takes either.
+        """
+        if hasattr(self.transform, 'weight_points_sparse'):
+            return self.transform.weight_points_sparse(points)
+        else:
+            return self.transform.weight_points(points)
+
+    def _dW_dp_from_dX_dp(self, dX_dp):
+        r"""
+        Chains the cached dW/dX with the given dX/dp.
+
+        Parameters
+        -----------
+        dX_dp : (L, P, D) ndarray
+            The Jacobian of the source landmarks wrt the weights.
+
+        Returns
+        -------
+        dW/dp : (N, P, D) ndarray
+            The Jacobian of the points wrt the weights.
+        """
+        if isinstance(self.dW_dX, tuple):
+            # sparse form - each point only depends on the three vertices of
+            # its triangle, so just gather those rows of dX/dp
+            vertex_index, weights = self.dW_dX
+            n_landmarks, n_params, n_dims = dX_dp.shape
+            dX_dp_c = np.require(dX_dp.reshape([n_landmarks, -1]),
+                                 dtype=np.float64, requirements=['C'])
+            dW_dp = weighted_sum_of_triangle_vertex_values(
+                vertex_index, weights, dX_dp_c)
+            return dW_dp.reshape([-1, n_params, n_dims])
+        else:
+            # dW_dX:    n_points   x    n_points    x  n_dims
+            # dX_dp:  n_points  x     n_params      x  n_dims
+            return np.einsum('ild, lpd -> ipd', self.dW_dX, dX_dp)
+
 
 # noinspection PyMissingConstructor
 class GlobalMDTransform(ModelDrivenTransform):
@@ -420,12 +478,17 @@ class GlobalMDTransform(ModelDrivenTransform):
         dW/dp : (N, P, D) ndarray
             The Jacobian of the ModelDrivenTransform evaluated at the
             previous points.
+
+        Notes
+        -----
+        dW/dX is cached on ``dW_dX`` for the given points, in the form
+        :meth:`_weight_points` gives it.
         """
         # check if re-computation of dW/dx can be avoided
         if not np.array_equal(self._cached_points, points):
             # recompute dW/dx, i.e. the relative weight of each point wrt
             # the source landmarks
-            self.dW_dX = self.transform.weight_points(points)
+            self.dW_dX = self._weight_points(points)
             # cache points
             self._cached_points = points
 
@@ -451,9 +514,7 @@ class GlobalMDTransform(ModelDrivenTransform):
         # dX/dp is simply the concatenation of the previous two terms
         dX_dp = np.hstack((dX_dq, dX_db))
 
-        # dW_dX:    n_points   x    n_points    x  n_dims
-        # dX_dp:  n_points  x     n_params      x  n_dims
-        dW_dp = np.einsum('ild, lpd -> ipd', self.dW_dX, dX_dp)
+        dW_dp = self._dW_dp_from_dX_dp(dX_dp)
         # dW_dp:    n_points   x     n_params      x  n_dims
 
         return dW_dp
@@ -3,7 +3,7 @@ import numpy as np
 
 from menpo.transform import Affine
 from menpo.transform.base import Alignment, Invertible, Transform
-from .fastpwa import CLookupPWA
+from .fastpwa import CLookupPWA, apply_affine_per_triangle
 # TODO View is broken for PWA (TriangleContainmentError)
 
 
@@ -143,10 +143,13 @@ class AbstractPWA(Alignment, Transform, Invertible):
         """
         return np.tile(np.eye(2, 2), [self.n_points, 1, 1])
 
-    def weight_points(self, points):
+    def weight_points_sparse(self, points):
         """
         Returns the jacobian of the warp at each point given in relation to the
-        source points.
+        source points in a compact form. Each point only depends on the
+        three vertices of its containing triangle, so only the indices of
+        these vertices and their weights are returned. The weight is the
+        same for both dimensions.
 
         Parameters
         ----------
@@ -155,9 +158,12 @@ class AbstractPWA(Alignment, Transform, Invertible):
 
         Returns
         -------
-        jacobian : (K, ``n_points``, 2) ndarray
-            The Jacobian for each of the ``K`` given points over each point in
-            the source points.
+        vertex_index : (K, 3) uint32 ndarray
+            The indices of the three source points each of the ``K`` points
+            depends on.
+        weights : (K, 3) ndarray
+            The Jacobian of each of the ``K`` points wrt each of those three
+            source points.
         """
         tri_index, alpha_i, beta_i = self.index_alpha_beta(points)
         # for the jacobian we only need
@@ -180,13 +186,34 @@ class AbstractPWA(Alignment, Transform, Invertible):
         gamma_ijk = np.hstack(((1 - alpha_i - beta_i)[:, None],
                                alpha_i[:, None],
                                beta_i[:, None]))
+        # per sample point, the source points for the ijk vertices of
+        # the containing triangle - only these points have a non 0
+        # jacobian value
+        ijk_per_point = np.require(self.trilist[tri_index], dtype=np.uint32,
+                                   requirements=['C'])
+        return ijk_per_point, gamma_ijk
+
+    def weight_points(self, points):
+        """
+        Returns the jacobian of the warp at each point given in relation to the
+        source points. Note that this is very sparse - see
+        :meth:`weight_points_sparse` for a compact form.
+
+        Parameters
+        ----------
+        points : (K, 2) ndarray
+            The points to calculate the Jacobian for.
+
+        Returns
+        -------
+        jacobian : (K, ``n_points``, 2) ndarray
+            The Jacobian for each of the ``K`` given points over each point in
+            the source points.
+        """
+        ijk_per_point, gamma_ijk = self.weight_points_sparse(points)
         # the jacobian wrt source is of shape
         # (n_sample_points, n_source_points, 2)
         jac = np.zeros((points.shape[0], self.n_points, 2))
-        # per sample point, find the source points for the ijk vertices of
-        # the containing triangle - only these points will get a non 0
-        # jacobian value
-        ijk_per_point = self.trilist[tri_index]
         # to index into the jacobian, we just need a linear iterator for the
         # first axis - literally [0, 1, ... , n_sample_points]. The
         # reshape is needed to make it broadcastable with the other indexing
@@ -436,9 +463,16 @@ class CachedPWA(AbstractPWA):
     r"""
     A piecewise affine transformation.
 
-    The apply method in this case involves dotting the triangle vectors with
-    the values of alpha and beta found. The calculation of alpha and beta is
-     done in C, and a hash map is used to cache lookup values.
+    The apply method in this case is done entirely in C - the alpha and beta
+    of each point in its containing source triangle are found (a hash map is
+    used to cache lookup values) and used directly to interpolate the target
+    triangle.
+
+    As the containing triangle of a point only depends on the source,
+    the triangle index of the last set of points applied is kept across
+    changes of target. Applying the same points again (as happens every
+    iteration of a fitting) just applies the affine transform of each
+    triangle, which is rebuilt on every target change.
 
     Parameters
     ----------
@@ -469,19 +503,21 @@ class CachedPWA(AbstractPWA):
                                requirements=['C'])
         # build the cython wrapped C object and store it locally
         self._fastpwa = CLookupPWA(source_c, trilist_c)
-        self.ti, self.tij, self.tik = None, None, None
-        self._rebuild_target_vectors()
+        # the last points applied and their containing triangles - only
+        # valid for this source
+        self._cached_points, self._cached_index = None, None
+        self._target_c, self._affines = None, None
+        self._rebuild_target_c()
 
-    def _rebuild_target_vectors(self):
+    def _rebuild_target_c(self):
         r"""
-        Rebuild the vectors that are used in the apply method. This needs to
-        be called whenever the target is changed.
+        Rebuild the C-contiguous copy of the target and the (``n_tris``,
+        2, 3) per triangle affine transforms that are handed to the C apply
+        methods. This needs to be called whenever the target is changed.
         """
-        t = self.target.points[self.trilist]
-        # get vectors ij ik for the target
-        self.tij, self.tik = t[:, 1] - t[:, 0], t[:, 2] - t[:, 0]
-        # target i'th vertex positions
-        self.ti = t[:, 0]
+        self._target_c = np.require(self.target.points, dtype=np.float64,
+                                    requirements=['C'])
+        self._affines = self._fastpwa.affines(self._target_c)
 
     def index_alpha_beta(self, points):
         points_c = np.require(points, dtype=np.float64, requirements=['C'])
@@ -494,10 +530,10 @@ class CachedPWA(AbstractPWA):
     def _sync_state_from_target(self):
         r"""
         CachedPWATransform is particularly efficient to sync
-        from target - we don't have to do much at all, just rebuild the target
-        vectors.
+        from target - we don't have to do much at all, just refresh the C
+        target.
         """
-        self._rebuild_target_vectors()
+        self._rebuild_target_c()
 
     def _apply(self, x, **kwargs):
         """
@@ -513,8 +549,52 @@ class CachedPWA(AbstractPWA):
         transformed : (K, 2) ndarray
             The transformed array.
         """
-        tri_index, alpha, beta = self.index_alpha_beta(x)
+        x_c = np.require(x, dtype=np.float64, requirements=['C'])
+        if np.array_equal(self._cached_points, x_c):
+            # we know the containing triangles already - no lookup needed
+            return apply_affine_per_triangle(x_c, self._cached_index,
+                                             self._affines)
+        # the lookup and the target interpolation happen in one pass in C
+        index, x_transformed = self._fastpwa.apply(x_c, self._target_c)
+        if np.any(index < 0):
+            raise TriangleContainmentError(index < 0)
+        self._cached_points, self._cached_index = x_c.copy(), index
+        return x_transformed
 
-        return (self.ti[tri_index] +
-                alpha[:, None] * self.tij[tri_index] +
-                beta[:, None] * self.tik[tri_index])
+    def sample_image(self, pixels, template_mask):
+        r"""
+        Bilinearly samples ``pixels`` at the location every True pixel of
+        ``template_mask`` is mapped to by this transform. This is done
+        triangle by triangle in C - each source triangle is scan-line
+        rasterised over the template and its affine transform is stepped
+        along each scan-line - so no points are ever looked up or
+        interpolated individually.
+
+        Parameters
+        ----------
+        pixels : (M, N, C) ndarray
+            The pixels to sample from.
+        template_mask : :class:`menpo.image.boolean.BooleanImage`
+            The 2D mask defining which locations to sample.
+
+        Returns
+        -------
+        sampled_pixel_values : (``template_mask.n_true``, C) ndarray
+            The sampled pixels, ordered as ``template_mask.true_indices``.
+            Samples outside of ``pixels`` are 0.
+
+        Raises
+        ------
+        TriangleContainmentError
+            All True pixels of ``template_mask`` must be contained in a
+            source triangle.
+        """
+        pixels_c = np.require(pixels, dtype=np.float64, requirements=['C'])
+        mask = template_mask.pixels[..., 0]
+        mask_c = np.require(mask, dtype=np.uint8, requirements=['C'])
+        warped, covered = self._fastpwa.warp_image(pixels_c, mask_c,
+                                                   self._affines)
+        outside = np.logical_and(mask, covered == 0)
+        if np.any(outside):
+            raise TriangleContainmentError(outside[mask])
+        return warped[mask]
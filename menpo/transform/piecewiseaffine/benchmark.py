@@ -0,0 +1,127 @@
+r"""
+Benchmark for the piecewise affine transform, driving both the C lookup
+(:class:`CLookupPWA`) and the full :class:`PiecewiseAffine` transform from
+Python. The pure C counterpart (without any Python overhead) lives in
+``fastpwa/main.c``.
+
+Run as
+
+    python -m menpo.transform.piecewiseaffine.benchmark [csv|json]
+
+For a range of triangle counts, point counts and point distributions this
+reports the time and lookups per second of each operation, together with
+the peak resident memory of the process after it.
+"""
+import json
+import resource
+import sys
+import time
+
+import numpy as np
+
+from menpo.shape import TriMesh, PointCloud
+from .base import CachedPWA, TriangleContainmentError
+from .fastpwa import CLookupPWA
+
+TRIANGLE_COUNTS = [10, 100, 1000, 10000]
+POINT_COUNTS = [1000, 10000, 100000]
+DISTRIBUTIONS = ['grid', 'random', 'repeated']
+FIELDS = ['n_triangles', 'n_points', 'distribution', 'mode', 'seconds',
+          'lookups_per_second', 'peak_rss_kb']
+
+
+def grid_mesh(n_triangles):
+    r"""
+    A jittered regular grid over [0, g] x [0, g] with close to
+    ``n_triangles`` triangles.
+    """
+    g = max(int(np.sqrt(n_triangles / 2.0)), 1)
+    rng = np.random.RandomState(42)
+    r, c = np.meshgrid(np.arange(g + 1), np.arange(g + 1), indexing='ij')
+    points = np.vstack([r.ravel(), c.ravel()]).T.astype(np.float64)
+    interior = np.all((points > 0) & (points < g), axis=1)
+    points[interior] += 0.3 * (rng.rand(interior.sum(), 2) - 0.5)
+    v = (r[:-1, :-1] * (g + 1) + c[:-1, :-1]).ravel()
+    trilist = np.vstack([np.vstack([v, v + 1, v + g + 1]).T,
+                         np.vstack([v + 1, v + g + 2, v + g + 1]).T])
+    return TriMesh(points, trilist.astype(np.uint32)), g
+
+
+def sample_points(distribution, n_points, g):
+    rng = np.random.RandomState(7)
+    if distribution == 'grid':
+        side = int(np.ceil(np.sqrt(n_points)))
+        step = float(g) / side
+        i = np.arange(n_points)
+        return np.vstack([(i // side + 0.5) * step,
+                          (i % side + 0.5) * step]).T
+    elif distribution == 'random':
+        return rng.rand(n_points, 2) * g
+    else:
+        # only a tenth of the points are distinct
+        distinct = rng.rand(max(n_points // 10, 1), 2) * g
+        return distinct[rng.randint(distinct.shape[0], size=n_points)]
+
+
+def timed(f):
+    start = time.time()
+    f()
+    return time.time() - start
+
+
+def benchmark():
+    results = []
+    for n_triangles in TRIANGLE_COUNTS:
+        mesh, g = grid_mesh(n_triangles)
+        target = PointCloud(1.5 * mesh.points + 3.0)
+        moved_target = PointCloud(target.points + 0.1)
+        for n_points in POINT_COUNTS:
+            for distribution in DISTRIBUTIONS:
+                points = np.require(sample_points(distribution, n_points, g),
+                                    requirements=['C'])
+                lookup = CLookupPWA(np.require(mesh.points,
+                                               requirements=['C']),
+                                    mesh.trilist)
+                pwa = CachedPWA(mesh, target)
+                timings = [
+                    ('lookup_cold', lambda: lookup.index_alpha_beta(points)),
+                    ('lookup_warm', lambda: lookup.index_alpha_beta(points)),
+                    ('apply_cold', lambda: pwa.apply(points)),
+                    ('apply_warm', lambda: pwa.apply(points)),
+                    ('set_target_and_apply',
+                     lambda: (pwa.set_target(moved_target),
+                              pwa.apply(points))),
+                    ('weight_points_sparse',
+                     lambda: pwa.weight_points_sparse(points))]
+                for mode, f in timings:
+                    # every sampled point lies in [0, g]^2, inside the mesh,
+                    # so a containment error means a lookup missed - report
+                    # it, and keep timing the other modes
+                    try:
+                        seconds = timed(f)
+                    except TriangleContainmentError as e:
+                        sys.stderr.write(
+                            'skipped {} ({} triangles, {} {} points): {} '
+                            'points outside the mesh\n'.format(
+                                mode, mesh.n_tris, n_points, distribution,
+                                np.sum(e.points_outside_source_domain)))
+                        continue
+                    peak = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+                    results.append(dict(
+                        n_triangles=mesh.n_tris, n_points=n_points,
+                        distribution=distribution, mode=mode,
+                        seconds=seconds,
+                        lookups_per_second=n_points / seconds if seconds else 0,
+                        peak_rss_kb=peak))
+    return results
+
+
+if __name__ == '__main__':
+    results = benchmark()
+    if len(sys.argv) > 1 and sys.argv[1] == 'json':
+        json.dump(results, sys.stdout, indent=2)
+        sys.stdout.write('\n')
+    else:
+        sys.stdout.write(','.join(FIELDS) + '\n')
+        for r in results:
+            sys.stdout.write(','.join(str(r[f]) for f in FIELDS) + '\n')
@@ -1,22 +1,26 @@
 # distutils: language = c
 # distutils: sources = ./menpo/transform/piecewiseaffine/fastpwa/pwa.c
-# distutils: extra_compile_args = -std=c99
+# distutils: extra_compile_args = -std=c99 -fopenmp
+# distutils: extra_link_args = -fopenmp
 
 import numpy as np
 cimport numpy as cnp
+from cpython.pythread cimport (PyThread_type_lock, PyThread_allocate_lock,
+                               PyThread_free_lock, PyThread_acquire_lock,
+                               PyThread_release_lock, WAIT_LOCK)
 
-cdef extern from "./fastpwa/pwa.h":
+cdef extern from "./fastpwa/pwa.h" nogil:
     ctypedef struct TriangleCollection:
         pass
 
-    ctypedef struct AlphaBetaIndex:
+    ctypedef struct AlphaBetaIndexCache:
         pass
 
     TriangleCollection initTriangleCollection(double *vertices,
                                               unsigned int *trilist,
                                               unsigned int n_triangles)
 
-    void arrayCachedAlphaBetaIndexForPoints(AlphaBetaIndex **hashMap,
+    void arrayCachedAlphaBetaIndexForPoints(AlphaBetaIndexCache *cache,
                                       TriangleCollection *tris,
                                       double *points,
                                       unsigned int n_points, int *indexes,
@@ -25,12 +29,134 @@ cdef extern from "./fastpwa/pwa.h":
                                       double *points,
                                       unsigned int n_points, int *indexes,
                                       double *alphas, double *betas)
-    void clearCacheAndDelete(AlphaBetaIndex **hashMap)
+    void arrayMapForPointsAndTargetPoints(AlphaBetaIndexCache *cache,
+                                          TriangleCollection *sourceTris,
+                                          TriangleCollection *targetTris,
+                                          double *points,
+                                          unsigned int n_points, int *indexes,
+                                          double *mappedPoints)
+    void clearCacheAndDelete(AlphaBetaIndexCache *cache)
     void deleteTriangleCollection(TriangleCollection *tris)
+    void affinesForTriangles(TriangleCollection *sourceTris,
+                             TriangleCollection *targetTris, double *affines)
+    void arrayApplyAffinePerTriangle(double *affines, int *indexes,
+                                     double *points, unsigned int n_points,
+                                     double *mappedPoints)
+    void arrayWeightedSumOfTriangleVertexValues(unsigned int *vertexIndexes,
+                                                double *weights,
+                                                unsigned int n_points,
+                                                double *values,
+                                                unsigned int n_values,
+                                                double *out)
+    void warpImageByTriangles(TriangleCollection *tris, double *affines,
+                              double *image, unsigned int n_rows,
+                              unsigned int n_cols, unsigned int n_channels,
+                              unsigned char *mask, unsigned int n_out_rows,
+                              unsigned int n_out_cols, double *out,
+                              unsigned char *covered)
+
+
+def apply_affine_per_triangle(double[:, ::1] points not None,
+                              int[::1] indexes not None,
+                              double[:, :, ::1] affines not None):
+    r"""
+    Applies to each point the affine transform of the triangle it has been
+    assigned to. No search is involved - this is pure arithmetic.
+
+    Parameters
+    ----------
+    points : (K, 2) c-contiguous double ndarray
+        Points to map.
+    indexes : (K,) c-contiguous int ndarray
+        The triangle each point belongs to. Must all be valid indexes into
+        ``affines``.
+    affines : (T, 2, 3) c-contiguous double ndarray
+        The affine transform of each triangle, as returned by
+        :meth:`CLookupPWA.affines`.
+
+    Returns
+    -------
+    mapped : (K, 2) double ndarray
+        The mapped points.
+    """
+    cdef unsigned int n_points = points.shape[0]
+    if indexes.shape[0] != n_points:
+        raise ValueError("points and indexes must have the same length")
+    if affines.shape[1] != 2 or affines.shape[2] != 3:
+        raise ValueError("affines must be a (n_tris, 2, 3) array")
+    cdef cnp.ndarray[double, ndim=2, mode='c'] mapped = \
+        np.empty((n_points, 2), dtype=np.float64)
+    if n_points == 0:
+        return mapped
+    cdef double *affines_ptr = &affines[0, 0, 0]
+    cdef int *indexes_ptr = &indexes[0]
+    cdef double *points_ptr = &points[0, 0]
+    cdef double *mapped_ptr = &mapped[0, 0]
+    with nogil:
+        arrayApplyAffinePerTriangle(affines_ptr, indexes_ptr, points_ptr,
+                                    n_points, mapped_ptr)
+    return mapped
+
+
+def weighted_sum_of_triangle_vertex_values(
+        unsigned[:, ::1] vertex_indexes not None,
+        double[:, ::1] weights not None, double[:, ::1] values not None):
+    r"""
+    For each point, the weighted sum of the rows of ``values`` belonging to
+    the three vertices of its triangle. This is the contraction of a sparse
+    PWA Jacobian (see ``AbstractPWA.weight_points_sparse``) with anything
+    defined per vertex (e.g. the Jacobian of a shape model).
+
+    Parameters
+    ----------
+    vertex_indexes : (K, 3) c-contiguous unsigned ndarray
+        The vertices of the triangle of each point.
+    weights : (K, 3) c-contiguous double ndarray
+        The weight of each of those vertices.
+    values : (n_vertices, M) c-contiguous double ndarray
+        The values to be gathered.
+
+    Returns
+    -------
+    out : (K, M) double ndarray
+        ``out[i] = sum_v weights[i, v] * values[vertex_indexes[i, v]]``
+    """
+    cdef unsigned int n_points = vertex_indexes.shape[0]
+    cdef unsigned int n_values = values.shape[1]
+    if vertex_indexes.shape[1] != 3 or weights.shape[1] != 3:
+        raise ValueError("vertex_indexes and weights must be (K, 3) arrays")
+    if weights.shape[0] != n_points:
+        raise ValueError("vertex_indexes and weights must have the same "
+                         "length")
+    cdef cnp.ndarray[double, ndim=2, mode='c'] out = \
+        np.empty((n_points, n_values), dtype=np.float64)
+    if n_points == 0 or n_values == 0:
+        return out
+    if np.any(np.asarray(vertex_indexes) >= values.shape[0]):
+        raise ValueError("vertex_indexes out of range of values")
+    cdef unsigned *vertex_indexes_ptr = &vertex_indexes[0, 0]
+    cdef double *weights_ptr = &weights[0, 0]
+    cdef double *values_ptr = &values[0, 0]
+    cdef double *out_ptr = &out[0, 0]
+    with nogil:
+        arrayWeightedSumOfTriangleVertexValues(vertex_indexes_ptr, weights_ptr,
+                                               n_points, values_ptr, n_values,
+                                               out_ptr)
+    return out
+
 
 cdef class CLookupPWA:
+    r"""
+    C lookup of the containing triangle and barycentric coordinates of points
+    in a fixed set of source triangles. Results are cached per point in a
+    sharded hash map, and all lookups run multithreaded with the GIL
+    released. Calls on the same instance from different Python threads are
+    serialised by an internal lock (as they share the cache), calls on
+    different instances run concurrently.
+    """
     cdef TriangleCollection tris
-    cdef AlphaBetaIndex *hashMap
+    cdef AlphaBetaIndexCache cache
+    cdef PyThread_type_lock lock
     cdef unsigned n_tris
     cdef object points
     cdef object trilist
@@ -38,9 +164,11 @@ cdef class CLookupPWA:
     def __cinit__(self,
                   double[:, ::1] points not None,
                   unsigned[:, ::1] trilist not None):
-        hashMap = NULL
         if points.shape[1] != 2:
             raise Exception
+        self.lock = PyThread_allocate_lock()
+        if self.lock == NULL:
+            raise MemoryError()
         self.n_tris = trilist.shape[0]
         self.points = points
         self.trilist = trilist
@@ -50,23 +178,25 @@ cdef class CLookupPWA:
     def _init_source_triangles(self,
                   double[:, ::1] points not None,
                   unsigned[:, ::1] trilist not None):
-        hashMap = NULL
         if points.shape[1] != 2:
             raise Exception
-        elif points.shape[0] != self.n_tris:
+        elif trilist.shape[0] != self.n_tris:
             raise Exception
+        # every cached lookup is relative to the old source - drop them all
+        PyThread_acquire_lock(self.lock, WAIT_LOCK)
+        clearCacheAndDelete(&self.cache)
+        deleteTriangleCollection(&self.tris)
+        self.points = points
+        self.trilist = trilist
         self.tris =  initTriangleCollection(&points[0,0], &trilist[0,0],
                                             self.n_tris)
-
-    def _init_target_triangles(
-            self, double[:, ::1] points not None,
-            unsigned[:, ::1] trilist not None):
-        self.target_tris = initTriangleCollection(
-            &points[0, 0], &trilist[0, 0], trilist.shape[0])
+        PyThread_release_lock(self.lock)
 
     def __dealloc__(self):
         deleteTriangleCollection(&self.tris)
-        clearCacheAndDelete(&self.hashMap)
+        clearCacheAndDelete(&self.cache)
+        if self.lock != NULL:
+            PyThread_free_lock(self.lock)
 
     def __reduce__(self):
         r"""
@@ -76,16 +206,148 @@ cdef class CLookupPWA:
                                 np.asarray(self.trilist))
 
     def index_alpha_beta(self, double[:, ::1] points not None):
+        cdef unsigned int n_points = points.shape[0]
         # create three c numpy arrays for storing our output into
         cdef cnp.ndarray[double, ndim=1, mode='c'] alphas = \
-            np.zeros(points.shape[0], dtype=np.float64)
+            np.zeros(n_points, dtype=np.float64)
         cdef cnp.ndarray[double, ndim=1, mode='c'] betas = \
-            np.zeros(points.shape[0], dtype=np.float64)
+            np.zeros(n_points, dtype=np.float64)
         cdef cnp.ndarray[int, ndim=1, mode='c'] indexes = \
-            np.zeros(points.shape[0], dtype=np.int32)
+            np.zeros(n_points, dtype=np.int32)
+        if n_points == 0:
+            return indexes, alphas, betas
+        cdef double *points_ptr = &points[0, 0]
+        cdef int *indexes_ptr = &indexes[0]
+        cdef double *alphas_ptr = &alphas[0]
+        cdef double *betas_ptr = &betas[0]
         # fill the arrays with the C results
-        arrayCachedAlphaBetaIndexForPoints(&self.hashMap, &self.tris,
-                                          &points[0,0],
-                                     points.shape[0], &indexes[0],
-                                     &alphas[0], &betas[0])
+        with nogil:
+            PyThread_acquire_lock(self.lock, WAIT_LOCK)
+            arrayCachedAlphaBetaIndexForPoints(&self.cache, &self.tris,
+                                               points_ptr, n_points,
+                                               indexes_ptr, alphas_ptr,
+                                               betas_ptr)
+            PyThread_release_lock(self.lock)
         return indexes, alphas, betas
+
+    def apply(self, double[:, ::1] points not None,
+              double[:, ::1] target not None):
+        r"""
+        Maps ``points`` from the source triangles onto the triangles formed by
+        ``target`` (which shares the source trilist) in a single pass.
+
+        Parameters
+        ----------
+        points : (K, 2) c-contiguous double ndarray
+            Points to map.
+        target : (n_points, 2) c-contiguous double ndarray
+            The target vertices.
+
+        Returns
+        -------
+        indexes : (K,) int ndarray
+            Containing source triangle for each point, -1 if not contained.
+        mapped : (K, 2) double ndarray
+            The mapped points (NaN where ``indexes`` is -1).
+        """
+        cdef unsigned[:, ::1] trilist = self.trilist
+        cdef unsigned int n_points = points.shape[0]
+        if target.shape[1] != 2 or target.shape[0] != self.points.shape[0]:
+            raise ValueError("target must be a (n_points, 2) array")
+        cdef cnp.ndarray[double, ndim=2, mode='c'] mapped = \
+            np.empty((n_points, 2), dtype=np.float64)
+        cdef cnp.ndarray[int, ndim=1, mode='c'] indexes = \
+            np.empty(n_points, dtype=np.int32)
+        if n_points == 0:
+            return indexes, mapped
+        cdef double *points_ptr = &points[0, 0]
+        cdef int *indexes_ptr = &indexes[0]
+        cdef double *mapped_ptr = &mapped[0, 0]
+        cdef TriangleCollection target_tris = initTriangleCollection(
+            &target[0, 0], &trilist[0, 0], self.n_tris)
+        with nogil:
+            PyThread_acquire_lock(self.lock, WAIT_LOCK)
+            arrayMapForPointsAndTargetPoints(&self.cache, &self.tris,
+                                             &target_tris, points_ptr,
+                                             n_points, indexes_ptr,
+                                             mapped_ptr)
+            PyThread_release_lock(self.lock)
+        deleteTriangleCollection(&target_tris)
+        return indexes, mapped
+
+    def affines(self, double[:, ::1] target not None):
+        r"""
+        The affine transform taking each source triangle onto the triangle
+        formed by ``target`` (which shares the source trilist).
+
+        Parameters
+        ----------
+        target : (n_points, 2) c-contiguous double ndarray
+            The target vertices.
+
+        Returns
+        -------
+        affines : (n_tris, 2, 3) double ndarray
+            The (non-homogeneous) affine transform for each triangle.
+        """
+        cdef unsigned[:, ::1] trilist = self.trilist
+        if target.shape[1] != 2 or target.shape[0] != self.points.shape[0]:
+            raise ValueError("target must be a (n_points, 2) array")
+        cdef cnp.ndarray[double, ndim=3, mode='c'] affines = \
+            np.empty((self.n_tris, 2, 3), dtype=np.float64)
+        cdef TriangleCollection target_tris = initTriangleCollection(
+            &target[0, 0], &trilist[0, 0], self.n_tris)
+        affinesForTriangles(&self.tris, &target_tris, &affines[0, 0, 0])
+        deleteTriangleCollection(&target_tris)
+        return affines
+
+    def warp_image(self, double[:, :, ::1] image not None,
+                   unsigned char[:, ::1] mask not None,
+                   double[:, :, ::1] affines not None):
+        r"""
+        Warps ``image`` into the frame of the source triangles, triangle by
+        triangle. Each source triangle is scan-line rasterised in the
+        frame of ``mask`` and every True pixel inside it is bilinearly
+        sampled from ``image`` at the position given by the triangle's
+        affine transform.
+
+        Parameters
+        ----------
+        image : (M, N, C) c-contiguous double ndarray
+            The image to sample from.
+        mask : (R, S) c-contiguous uint8 ndarray
+            The output frame - only non-zero pixels are sampled.
+        affines : (n_tris, 2, 3) c-contiguous double ndarray
+            The affine transform of each triangle, as returned by
+            :meth:`affines`.
+
+        Returns
+        -------
+        warped : (R, S, C) double ndarray
+            The warped image. Samples outside of ``image`` are 0.
+        covered : (R, S) uint8 ndarray
+            1 for every pixel that was sampled.
+        """
+        if affines.shape[0] != self.n_tris or affines.shape[1] != 2 or \
+                affines.shape[2] != 3:
+            raise ValueError("affines must be a (n_tris, 2, 3) array")
+        cdef unsigned int n_out_rows = mask.shape[0]
+        cdef unsigned int n_out_cols = mask.shape[1]
+        cdef cnp.ndarray[double, ndim=3, mode='c'] warped = \
+            np.zeros((n_out_rows, n_out_cols, image.shape[2]),
+                     dtype=np.float64)
+        cdef cnp.ndarray[cnp.uint8_t, ndim=2, mode='c'] covered = \
+            np.zeros((n_out_rows, n_out_cols), dtype=np.uint8)
+        if warped.size == 0 or image.size == 0 or self.n_tris == 0:
+            return warped, covered
+        cdef double *affines_ptr = &affines[0, 0, 0]
+        cdef double *image_ptr = &image[0, 0, 0]
+        cdef unsigned char *mask_ptr = &mask[0, 0]
+        cdef double *warped_ptr = &warped[0, 0, 0]
+        cdef unsigned char *covered_ptr = &covered[0, 0]
+        with nogil:
+            warpImageByTriangles(&self.tris, affines_ptr, image_ptr,
+                                 image.shape[0], image.shape[1],
+                                 image.shape[2], mask_ptr, n_out_rows,
+                                 n_out_cols, warped_ptr, covered_ptr)
+        return warped, covered
@@ -1,27 +1,289 @@
+// Benchmark for the fastpwa lookups. Build with `make` in this directory and
+// run as
+//
+//   ./benchmark.out [csv|json]
+//
+// For a range of triangle counts, point counts and point distributions this
+// times the uncached lookup, the cached lookup on a cold and on a warm cache,
+// the fused map onto a target and the per-triangle affine apply, reporting
+// lookups per second, the cache hit rate, the cache memory footprint and the
+// number of allocations made.
 #include <stdio.h>
+#include <string.h>
+#include <time.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 #include "pwa.h"
 
+static const unsigned int TRIANGLE_COUNTS[] = {10, 100, 1000, 10000};
+static const unsigned int POINT_COUNTS[] = {1000, 10000, 100000};
+static const char *DISTRIBUTIONS[] = {"grid", "random", "repeated"};
 
-int main(int argc, char** argv)
+#define N_ELEMENTS(a) (sizeof(a) / sizeof(a[0]))
+
+typedef struct {
+  unsigned int n_triangles;
+  unsigned int n_points;
+  const char *distribution;
+  const char *mode;
+  double seconds;
+  double hit_rate;
+  unsigned long cache_entries;
+  unsigned long cache_bytes;
+  unsigned long allocations;
+} Result;
+
+static double now(void)
 {
-  double vertices [] = {0., 0.,
-                        1., 0.,
-                        2., 1.3,
-                        0., 1.};
-  unsigned int trilist [] = {0, 1, 3,
-                             1, 2, 3};
-  // make our hash
-  AlphaBetaIndex *alphaBetaIndexHash = NULL;
-  TriangleCollection tris = initTriangleCollection(vertices, trilist, 2);
-  printf("Built a TrangleCollection with %u triangles\n", tris.n_triangles);
-  double queryPoints [] = {0., 0.1,
-                           0.2, 0.4};
-  double alpha [2];
-  double beta [2];
-  int index [2];
-  arrayAlphaBetaIndexForPoints(&alphaBetaIndexHash, &tris, queryPoints, 2, index, alpha, beta);
-  arrayAlphaBetaIndexForPoints(&alphaBetaIndexHash, &tris, queryPoints, 2, index, alpha, beta);
-  deleteTriangleCollection(&tris);
+#ifdef _OPENMP
+  return omp_get_wtime();
+#else
+  return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+static unsigned long allocations(void)
+{
+#ifdef PWA_TRACK_ALLOCATIONS
+  return pwaAllocationCount;
+#else
   return 0;
+#endif
+}
+
+// uniform in [0, 1) from a fixed seed so that runs are comparable
+static double uniform(unsigned long *state)
+{
+  *state = *state * 6364136223846793005UL + 1442695040888963407UL;
+  return (double)(*state >> 11) / 9007199254740992.0;
+}
+
+// a g x g grid of cells over [0, g] x [0, g], each split into two triangles,
+// with the interior vertices slightly jittered. Returns the number of
+// triangles (2 * g * g).
+static unsigned int buildMesh(unsigned int g, double **vertices, unsigned int **trilist)
+{
+  unsigned long state = 42;
+  unsigned int n = g + 1;
+  *vertices = (double *)malloc(n * n * 2 * sizeof(double));
+  *trilist = (unsigned int *)malloc(g * g * 6 * sizeof(unsigned int));
+  for (unsigned int r = 0; r < n; r++) {
+    for (unsigned int c = 0; c < n; c++) {
+      int interior = r > 0 && c > 0 && r < g && c < g;
+      (*vertices)[(r * n + c) * 2] = r + (interior ? 0.3 * (uniform(&state) - 0.5) : 0);
+      (*vertices)[(r * n + c) * 2 + 1] = c + (interior ? 0.3 * (uniform(&state) - 0.5) : 0);
+    }
+  }
+  unsigned int *t = *trilist;
+  for (unsigned int r = 0; r < g; r++) {
+    for (unsigned int c = 0; c < g; c++) {
+      unsigned int v = r * n + c;
+      *t++ = v; *t++ = v + 1; *t++ = v + n;
+      *t++ = v + 1; *t++ = v + n + 1; *t++ = v + n;
+    }
+  }
+  return 2 * g * g;
+}
+
+static double* buildPoints(const char *distribution, unsigned int n_points, unsigned int g)
+{
+  unsigned long state = 7;
+  double *points = (double *)malloc(n_points * 2 * sizeof(double));
+  if (strcmp(distribution, "grid") == 0) {
+    // a dense raster over the domain, as when warping an image
+    unsigned int side = 1;
+    while (side * side < n_points) {
+      side++;
+    }
+    double step = (double)g / side;
+    for (unsigned int i = 0; i < n_points; i++) {
+      points[i * 2] = (i / side + 0.5) * step;
+      points[i * 2 + 1] = (i % side + 0.5) * step;
+    }
+  } else if (strcmp(distribution, "random") == 0) {
+    for (unsigned int i = 0; i < n_points * 2; i++) {
+      points[i] = uniform(&state) * g;
+    }
+  } else {
+    // only a tenth of the points are distinct
+    unsigned int n_distinct = n_points / 10 > 0 ? n_points / 10 : 1;
+    for (unsigned int i = 0; i < n_distinct * 2; i++) {
+      points[i] = uniform(&state) * g;
+    }
+    for (unsigned int i = n_distinct; i < n_points; i++) {
+      unsigned int j = (unsigned int)(uniform(&state) * n_distinct);
+      points[i * 2] = points[j * 2];
+      points[i * 2 + 1] = points[j * 2 + 1];
+    }
+  }
+  return points;
+}
+
+static unsigned long cacheEntries(AlphaBetaIndexCache *cache)
+{
+  unsigned long entries = 0;
+  for (unsigned int s = 0; s < N_CACHE_SHARDS; s++) {
+    entries += HASH_COUNT(cache->shards[s]);
+  }
+  return entries;
 }
 
+static unsigned long cacheBytes(AlphaBetaIndexCache *cache)
+{
+  unsigned long bytes = sizeof(AlphaBetaIndexCache);
+  for (unsigned int s = 0; s < N_CACHE_SHARDS; s++) {
+    if (cache->shards[s]) {
+      UT_hash_table *tbl = cache->shards[s]->hh.tbl;
+      bytes += sizeof(UT_hash_table) + tbl->num_buckets * sizeof(UT_hash_bucket) +
+               tbl->num_items * sizeof(AlphaBetaIndex);
+    }
+  }
+  return bytes;
+}
+
+static void printResult(Result r, int json, int first)
+{
+  double rate = r.seconds > 0 ? r.n_points / r.seconds : 0;
+  if (json) {
+    printf("%s  {\"n_triangles\": %u, \"n_points\": %u, \"distribution\": \"%s\", "
+           "\"mode\": \"%s\", \"seconds\": %.6g, \"lookups_per_second\": %.6g, "
+           "\"cache_hit_rate\": %.4f, \"cache_entries\": %lu, \"cache_bytes\": %lu, "
+           "\"allocations\": %lu}",
+           first ? "" : ",\n", r.n_triangles, r.n_points, r.distribution, r.mode,
+           r.seconds, rate, r.hit_rate, r.cache_entries, r.cache_bytes, r.allocations);
+  } else {
+    printf("%u,%u,%s,%s,%.6g,%.6g,%.4f,%lu,%lu,%lu\n",
+           r.n_triangles, r.n_points, r.distribution, r.mode, r.seconds, rate,
+           r.hit_rate, r.cache_entries, r.cache_bytes, r.allocations);
+  }
+}
+
+int main(int argc, char** argv)
+{
+  int json = argc > 1 && strcmp(argv[1], "json") == 0;
+  int first = 1;
+  if (json) {
+    printf("[\n");
+  } else {
+    printf("n_triangles,n_points,distribution,mode,seconds,lookups_per_second,"
+           "cache_hit_rate,cache_entries,cache_bytes,allocations\n");
+  }
+  for (unsigned int t = 0; t < N_ELEMENTS(TRIANGLE_COUNTS); t++) {
+    // the grid with the closest number of triangles to that requested
+    unsigned int g = 1;
+    while (2 * (g + 1) * (g + 1) <= TRIANGLE_COUNTS[t]) {
+      g++;
+    }
+    double *vertices, *target;
+    unsigned int *trilist;
+    unsigned int n_triangles = buildMesh(g, &vertices, &trilist);
+    unsigned int n_vertices = (g + 1) * (g + 1);
+    target = (double *)malloc(n_vertices * 2 * sizeof(double));
+    for (unsigned int i = 0; i < n_vertices * 2; i++) {
+      target[i] = 1.5 * vertices[i] + 3.0;
+    }
+    TriangleCollection tris = initTriangleCollection(vertices, trilist, n_triangles);
+    TriangleCollection targetTris = initTriangleCollection(target, trilist, n_triangles);
+    double *affines = (double *)malloc(n_triangles * 6 * sizeof(double));
+    affinesForTriangles(&tris, &targetTris, affines);
+
+    for (unsigned int p = 0; p < N_ELEMENTS(POINT_COUNTS); p++) {
+      unsigned int n_points = POINT_COUNTS[p];
+      int *indexes = (int *)malloc(n_points * sizeof(int));
+      double *alphas = (double *)malloc(n_points * sizeof(double));
+      double *betas = (double *)malloc(n_points * sizeof(double));
+      double *mapped = (double *)malloc(n_points * 2 * sizeof(double));
+      for (unsigned int d = 0; d < N_ELEMENTS(DISTRIBUTIONS); d++) {
+        double *points = buildPoints(DISTRIBUTIONS[d], n_points, g);
+        AlphaBetaIndexCache cache;
+        memset(&cache, 0, sizeof(AlphaBetaIndexCache));
+        Result r = {n_triangles, n_points, DISTRIBUTIONS[d], "", 0, 0, 0, 0, 0};
+        unsigned long entriesBefore, allocationsBefore;
+        double start;
+
+        r.mode = "uncached";
+        allocationsBefore = allocations();
+        start = now();
+        arrayAlphaBetaIndexForPoints(&tris, points, n_points, indexes, alphas, betas);
+        r.seconds = now() - start;
+        r.allocations = allocations() - allocationsBefore;
+        printResult(r, json, first);
+        first = 0;
+
+        r.mode = "cached_cold";
+        entriesBefore = cacheEntries(&cache);
+        allocationsBefore = allocations();
+        start = now();
+        arrayCachedAlphaBetaIndexForPoints(&cache, &tris, points, n_points,
+                                           indexes, alphas, betas);
+        r.seconds = now() - start;
+        r.allocations = allocations() - allocationsBefore;
+        r.cache_entries = cacheEntries(&cache);
+        r.cache_bytes = cacheBytes(&cache);
+        r.hit_rate = 1.0 - (double)(r.cache_entries - entriesBefore) / n_points;
+        printResult(r, json, first);
+
+        r.mode = "cached_warm";
+        entriesBefore = cacheEntries(&cache);
+        allocationsBefore = allocations();
+        start = now();
+        arrayCachedAlphaBetaIndexForPoints(&cache, &tris, points, n_points,
+                                           indexes, alphas, betas);
+        r.seconds = now() - start;
+        r.allocations = allocations() - allocationsBefore;
+        r.cache_entries = cacheEntries(&cache);
+        r.cache_bytes = cacheBytes(&cache);
+        r.hit_rate = 1.0 - (double)(r.cache_entries - entriesBefore) / n_points;
+        printResult(r, json, first);
+
+        r.mode = "map_warm";
+        entriesBefore = cacheEntries(&cache);
+        allocationsBefore = allocations();
+        start = now();
+        arrayMapForPointsAndTargetPoints(&cache, &tris, &targetTris, points, n_points,
+                                         indexes, mapped);
+        r.seconds = now() - start;
+        r.allocations = allocations() - allocationsBefore;
+        r.cache_entries = cacheEntries(&cache);
+        r.cache_bytes = cacheBytes(&cache);
+        r.hit_rate = 1.0 - (double)(r.cache_entries - entriesBefore) / n_points;
+        printResult(r, json, first);
+
+        // the per-triangle affine apply needs every point to be contained
+        r.mode = "affine";
+        r.hit_rate = 0;
+        r.cache_entries = 0;
+        r.cache_bytes = 0;
+        for (unsigned int i = 0; i < n_points; i++) {
+          if (indexes[i] < 0) {
+            indexes[i] = 0;
+          }
+        }
+        allocationsBefore = allocations();
+        start = now();
+        arrayApplyAffinePerTriangle(affines, indexes, points, n_points, mapped);
+        r.seconds = now() - start;
+        r.allocations = allocations() - allocationsBefore;
+        printResult(r, json, first);
+
+        clearCacheAndDelete(&cache);
+        free(points);
+      }
+      free(indexes);
+      free(alphas);
+      free(betas);
+      free(mapped);
+    }
+    deleteTriangleCollection(&tris);
+    deleteTriangleCollection(&targetTris);
+    free(affines);
+    free(vertices);
+    free(target);
+    free(trilist);
+  }
+  if (json) {
+    printf("\n]\n");
+  }
+  return 0;
+}
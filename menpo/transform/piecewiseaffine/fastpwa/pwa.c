@@ -1,9 +1,23 @@
 #include "pwa.h"
 
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
 #include "uthash.h"
 
+#ifdef PWA_TRACK_ALLOCATIONS
+unsigned long pwaAllocationCount = 0;
+
+void *pwaMalloc(size_t size)
+{
+  #pragma omp atomic
+  pwaAllocationCount++;
+  return malloc(size);
+}
+#endif
+
 //
 // ----- POINT -----
 //
@@ -81,7 +95,7 @@ TriangleCollection initTriangleCollection(double *vertices, unsigned int *trilis
 {
   TriangleCollection tris;
   tris.n_triangles = n_triangles;
-  tris.triangles = (Triangle *)malloc(n_triangles * sizeof(Triangle));
+  tris.triangles = (Triangle *)PWA_MALLOC(n_triangles * sizeof(Triangle));
   for (unsigned int i = 0; i < n_triangles; i++) {
     tris.triangles[i] = initTriangle(&trilist[i * 3], vertices);
   }
@@ -132,7 +146,7 @@ void addAlphaBetaIndexToCache(AlphaBetaIndex **hash, Point queryPoint, int index
 {
   // dynamically allocate a new result object
   AlphaBetaIndex *result;
-  result = malloc(sizeof(AlphaBetaIndex));
+  result = PWA_MALLOC(sizeof(AlphaBetaIndex));
   memset(result, 0, sizeof(AlphaBetaIndex));
   result->queryPoint = queryPoint;
   result->index = index;
@@ -159,33 +173,276 @@ void cachedAlphaBetaIndexForPointInTriangleCollection(AlphaBetaIndex **hash, Tri
   }
 }
 
-void arrayCachedAlphaBetaIndexForPoints(AlphaBetaIndex **hash, TriangleCollection *tris, double *points, unsigned int n_points,
-                                  int *indexes, double *alphas, double *betas)
+unsigned int shardForPoint(Point p)
+{
+  // mix the raw bits of the point (the hash map itself keys on the bytes)
+  uint64_t x, y;
+  memcpy(&x, &p.x, sizeof(uint64_t));
+  memcpy(&y, &p.y, sizeof(uint64_t));
+  uint64_t h = x * 0x9E3779B97F4A7C15ULL ^ (y + 0x632BE59BD9B4E019ULL);
+  h ^= h >> 29;
+  h *= 0xBF58476D1CE4E5B9ULL;
+  h ^= h >> 32;
+  return (unsigned int)(h % N_CACHE_SHARDS);
+}
+
+// Counting sort of the point indices by shard. On return the points of shard
+// s are order[shardStart[s]] ... order[shardStart[s + 1] - 1]. The caller
+// owns (and must free) order.
+static unsigned int* pointsOrderedByShard(double *points, unsigned int n_points,
+                                          unsigned int *shardStart)
 {
+  unsigned int *shard = (unsigned int *)PWA_MALLOC(n_points * sizeof(unsigned int));
+  unsigned int *order = (unsigned int *)PWA_MALLOC(n_points * sizeof(unsigned int));
+  unsigned int fill[N_CACHE_SHARDS];
+  memset(shardStart, 0, (N_CACHE_SHARDS + 1) * sizeof(unsigned int));
+  #pragma omp parallel for
+  for (int i = 0; i < (int)n_points; i++) {
+    shard[i] = shardForPoint(initPoint(points + i * 2));
+  }
   for (unsigned int i = 0; i < n_points; i++) {
-    // build a point object
-    Point queryPoint = initPoint(points + i * 2);
-    cachedAlphaBetaIndexForPointInTriangleCollection(hash, tris, queryPoint,
-                                                     indexes + i, alphas + i, betas + i);
+    shardStart[shard[i] + 1]++;
+  }
+  for (unsigned int s = 0; s < N_CACHE_SHARDS; s++) {
+    shardStart[s + 1] += shardStart[s];
+    fill[s] = shardStart[s];
   }
+  for (unsigned int i = 0; i < n_points; i++) {
+    order[fill[shard[i]]++] = i;
+  }
+  free(shard);
+  return order;
+}
+
+void arrayCachedAlphaBetaIndexForPoints(AlphaBetaIndexCache *cache, TriangleCollection *tris,
+                                        double *points, unsigned int n_points,
+                                        int *indexes, double *alphas, double *betas)
+{
+  unsigned int shardStart[N_CACHE_SHARDS + 1];
+  unsigned int *order = pointsOrderedByShard(points, n_points, shardStart);
+  // each shard is only ever touched by the thread that owns it
+  #pragma omp parallel for schedule(dynamic)
+  for (int s = 0; s < N_CACHE_SHARDS; s++) {
+    for (unsigned int o = shardStart[s]; o < shardStart[s + 1]; o++) {
+      unsigned int i = order[o];
+      Point queryPoint = initPoint(points + i * 2);
+      cachedAlphaBetaIndexForPointInTriangleCollection(&cache->shards[s], tris, queryPoint,
+                                                       indexes + i, alphas + i, betas + i);
+    }
+  }
+  free(order);
 }
 
 void arrayAlphaBetaIndexForPoints(TriangleCollection *tris, double *points, unsigned int n_points,
                                   int *indexes, double *alphas, double *betas)
 {
-  for (unsigned int i = 0; i < n_points; i++) {
+  #pragma omp parallel for
+  for (int i = 0; i < (int)n_points; i++) {
     // build a point object
     Point queryPoint = initPoint(points + i * 2);
     containingTriangleAndAlphaBetaForPoint(tris, queryPoint, indexes + i, alphas + i, betas + i);
   }
 }
 
-void clearCacheAndDelete(AlphaBetaIndex **hash)
+void arrayMapForPointsAndTargetPoints(AlphaBetaIndexCache *cache, TriangleCollection *sourceTris,
+                                      TriangleCollection *targetTris, double *points, unsigned int n_points,
+                                      int *indexes, double *mappedPoints)
+{
+  unsigned int shardStart[N_CACHE_SHARDS + 1];
+  unsigned int *order = pointsOrderedByShard(points, n_points, shardStart);
+  #pragma omp parallel for schedule(dynamic)
+  for (int s = 0; s < N_CACHE_SHARDS; s++) {
+    double alpha, beta;
+    Triangle t;
+    for (unsigned int o = shardStart[s]; o < shardStart[s + 1]; o++) {
+      unsigned int i = order[o];
+      Point queryPoint = initPoint(points + i * 2);
+      cachedAlphaBetaIndexForPointInTriangleCollection(&cache->shards[s], sourceTris, queryPoint,
+                                                       indexes + i, &alpha, &beta);
+      if (indexes[i] < 0) {
+        // not contained in any source triangle - caller is expected to check indexes
+        mappedPoints[i * 2] = NAN;
+        mappedPoints[i * 2 + 1] = NAN;
+        continue;
+      }
+      // the alpha/beta weights carry straight over to the target triangle
+      t = targetTris->triangles[indexes[i]];
+      mappedPoints[i * 2] = t.i.x + alpha * (t.j.x - t.i.x) + beta * (t.k.x - t.i.x);
+      mappedPoints[i * 2 + 1] = t.i.y + alpha * (t.j.y - t.i.y) + beta * (t.k.y - t.i.y);
+    }
+  }
+  free(order);
+}
+
+void clearCacheAndDelete(AlphaBetaIndexCache *cache)
 {
   AlphaBetaIndex *currentResult, *tmp;
-  HASH_ITER(hh, *hash, currentResult, tmp) {
-    HASH_DEL(*hash, currentResult);  /* delete; users advances to next */
-    free(currentResult);            /* optional- if you want to free  */
+  for (unsigned int s = 0; s < N_CACHE_SHARDS; s++) {
+    HASH_ITER(hh, cache->shards[s], currentResult, tmp) {
+      HASH_DEL(cache->shards[s], currentResult);  /* delete; users advances to next */
+      free(currentResult);            /* optional- if you want to free  */
+    }
+  }
+}
+
+//
+// ----- AFFINE PER TRIANGLE -----
+//
+void affinesForTriangles(TriangleCollection *sourceTris, TriangleCollection *targetTris,
+                         double *affines)
+{
+  for (unsigned int i = 0; i < sourceTris->n_triangles; i++) {
+    Triangle s = sourceTris->triangles[i];
+    Triangle t = targetTris->triangles[i];
+    Point sij = pointSubtract(s.j, s.i);
+    Point sik = pointSubtract(s.k, s.i);
+    Point tij = pointSubtract(t.j, t.i);
+    Point tik = pointSubtract(t.k, t.i);
+    double d = 1.0 / (sij.x * sik.y - sik.x * sij.y);
+    double *a = affines + i * 6;
+    // linear part is [tij tik] * inv([sij sik])
+    a[0] = (tij.x * sik.y - tik.x * sij.y) * d;
+    a[1] = (tik.x * sij.x - tij.x * sik.x) * d;
+    a[3] = (tij.y * sik.y - tik.y * sij.y) * d;
+    a[4] = (tik.y * sij.x - tij.y * sik.x) * d;
+    // translation takes the source i'th vertex onto the target i'th vertex
+    a[2] = t.i.x - a[0] * s.i.x - a[1] * s.i.y;
+    a[5] = t.i.y - a[3] * s.i.x - a[4] * s.i.y;
+  }
+}
+
+void arrayApplyAffinePerTriangle(double *affines, int *indexes,
+                                 double *points, unsigned int n_points,
+                                 double *mappedPoints)
+{
+  #pragma omp parallel for
+  for (int i = 0; i < (int)n_points; i++) {
+    double *a = affines + indexes[i] * 6;
+    double x = points[i * 2];
+    double y = points[i * 2 + 1];
+    mappedPoints[i * 2] = a[0] * x + a[1] * y + a[2];
+    mappedPoints[i * 2 + 1] = a[3] * x + a[4] * y + a[5];
+  }
+}
+
+void arrayWeightedSumOfTriangleVertexValues(unsigned int *vertexIndexes, double *weights,
+                                            unsigned int n_points, double *values,
+                                            unsigned int n_values, double *out)
+{
+  #pragma omp parallel for
+  for (int i = 0; i < (int)n_points; i++) {
+    double *o = out + (size_t)i * n_values;
+    double *a = values + (size_t)vertexIndexes[i * 3] * n_values;
+    double *b = values + (size_t)vertexIndexes[i * 3 + 1] * n_values;
+    double *c = values + (size_t)vertexIndexes[i * 3 + 2] * n_values;
+    double wa = weights[i * 3], wb = weights[i * 3 + 1], wc = weights[i * 3 + 2];
+    for (unsigned int j = 0; j < n_values; j++) {
+      o[j] = wa * a[j] + wb * b[j] + wc * c[j];
+    }
   }
 }
 
+//
+// ----- IMAGE WARPING -----
+//
+#define SPAN_EPS 1e-10
+
+static void sampleBilinear(double *image, unsigned int n_rows, unsigned int n_cols,
+                           unsigned int n_channels, double r, double c, double *out)
+{
+  if (r < 0 || c < 0 || r > (double)n_rows - 1 || c > (double)n_cols - 1) {
+    for (unsigned int ch = 0; ch < n_channels; ch++) {
+      out[ch] = 0;
+    }
+    return;
+  }
+  unsigned int r0 = (unsigned int)r, c0 = (unsigned int)c;
+  unsigned int r1 = r0 + 1 < n_rows ? r0 + 1 : r0;
+  unsigned int c1 = c0 + 1 < n_cols ? c0 + 1 : c0;
+  double dr = r - r0, dc = c - c0;
+  double *f00 = image + ((size_t)r0 * n_cols + c0) * n_channels;
+  double *f01 = image + ((size_t)r0 * n_cols + c1) * n_channels;
+  double *f10 = image + ((size_t)r1 * n_cols + c0) * n_channels;
+  double *f11 = image + ((size_t)r1 * n_cols + c1) * n_channels;
+  for (unsigned int ch = 0; ch < n_channels; ch++) {
+    out[ch] = (1 - dr) * ((1 - dc) * f00[ch] + dc * f01[ch]) +
+              dr * ((1 - dc) * f10[ch] + dc * f11[ch]);
+  }
+}
+
+// the extent along the second axis of triangle t on the scan-line at r
+static int triangleSpanAtRow(Triangle t, double r, double *lo, double *hi)
+{
+  Point v[3] = {t.i, t.j, t.k};
+  double minX = fmin(t.i.x, fmin(t.j.x, t.k.x));
+  double maxX = fmax(t.i.x, fmax(t.j.x, t.k.x));
+  // snap scan-lines that just graze a vertex onto it
+  r = fmin(fmax(r, minX), maxX);
+  *lo = INFINITY;
+  *hi = -INFINITY;
+  for (unsigned int e = 0; e < 3; e++) {
+    Point u = v[e], w = v[(e + 1) % 3];
+    if ((u.x - r) * (w.x - r) > 0) {
+      continue;  // edge does not cross this scan-line
+    }
+    if (u.x == w.x) {
+      *lo = fmin(*lo, fmin(u.y, w.y));
+      *hi = fmax(*hi, fmax(u.y, w.y));
+    } else {
+      double y = u.y + (r - u.x) / (w.x - u.x) * (w.y - u.y);
+      *lo = fmin(*lo, y);
+      *hi = fmax(*hi, y);
+    }
+  }
+  return *lo <= *hi;
+}
+
+void warpImageByTriangles(TriangleCollection *tris, double *affines,
+                          double *image, unsigned int n_rows, unsigned int n_cols,
+                          unsigned int n_channels, unsigned char *mask,
+                          unsigned int n_out_rows, unsigned int n_out_cols,
+                          double *out, unsigned char *covered)
+{
+  unsigned int n_tris = tris->n_triangles;
+  int *rowStart = (int *)PWA_MALLOC(n_tris * sizeof(int));
+  int *rowEnd = (int *)PWA_MALLOC(n_tris * sizeof(int));
+  for (unsigned int i = 0; i < n_tris; i++) {
+    Triangle t = tris->triangles[i];
+    double minX = fmin(t.i.x, fmin(t.j.x, t.k.x));
+    double maxX = fmax(t.i.x, fmax(t.j.x, t.k.x));
+    rowStart[i] = (int)fmax(ceil(minX - SPAN_EPS), 0);
+    rowEnd[i] = (int)fmin(floor(maxX + SPAN_EPS), (double)n_out_rows - 1);
+  }
+  // each scan-line is owned by one thread, so no two threads ever write the
+  // same pixel. Within a scan-line the first triangle containing a pixel
+  // wins (as for the point lookup).
+  #pragma omp parallel for schedule(dynamic, 4)
+  for (int r = 0; r < (int)n_out_rows; r++) {
+    for (unsigned int i = 0; i < n_tris; i++) {
+      double lo, hi;
+      if (r < rowStart[i] || r > rowEnd[i] ||
+          !triangleSpanAtRow(tris->triangles[i], r, &lo, &hi)) {
+        continue;
+      }
+      int cStart = (int)fmax(ceil(lo - SPAN_EPS), 0);
+      int cEnd = (int)fmin(floor(hi + SPAN_EPS), (double)n_out_cols - 1);
+      if (cStart > cEnd) {
+        continue;
+      }
+      // step the affine map incrementally along the scan-line
+      double *a = affines + i * 6;
+      double sr = a[0] * r + a[1] * cStart + a[2];
+      double sc = a[3] * r + a[4] * cStart + a[5];
+      for (int c = cStart; c <= cEnd; c++, sr += a[1], sc += a[4]) {
+        size_t p = (size_t)r * n_out_cols + c;
+        if (mask[p] && !covered[p]) {
+          sampleBilinear(image, n_rows, n_cols, n_channels, sr, sc,
+                         out + p * n_channels);
+          covered[p] = 1;
+        }
+      }
+    }
+  }
+  free(rowStart);
+  free(rowEnd);
+}
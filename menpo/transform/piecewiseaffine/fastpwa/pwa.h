@@ -1,4 +1,17 @@
 #pragma once
+#include <stdlib.h>
+
+// Building with PWA_TRACK_ALLOCATIONS counts every allocation made by this
+// library (including those of the uthash cache) in pwaAllocationCount. This
+// is only intended for benchmarking (see main.c).
+#ifdef PWA_TRACK_ALLOCATIONS
+extern unsigned long pwaAllocationCount;
+void *pwaMalloc(size_t size);
+#define PWA_MALLOC(size) pwaMalloc(size)
+#else
+#define PWA_MALLOC(size) malloc(size)
+#endif
+#define uthash_malloc(size) PWA_MALLOC(size)
 #include "uthash.h"
 
 typedef struct {
@@ -41,19 +54,61 @@ typedef struct {
   UT_hash_handle hh;
 } AlphaBetaIndex;
 
+// The cache is split into shards by a hash of the query point. A given point
+// always lands in the same shard, so each shard can be owned by a single
+// thread for the duration of an array call without any locking.
+#define N_CACHE_SHARDS 64
+
+typedef struct {
+  AlphaBetaIndex *shards[N_CACHE_SHARDS];
+} AlphaBetaIndexCache;
+
+unsigned int shardForPoint(Point p);
+
 AlphaBetaIndex* retrieveAlphaBetaFromCache(AlphaBetaIndex **hash, Point queryPoint);
 // should only be called after retrieveAlphaBetaFromCache has returned NULL
 void addAlphaBetaIndexToCache(AlphaBetaIndex **hash, Point queryPoint, int index, double alpha, double beta);
 void cachedAlphaBetaIndexForPointInTriangleCollection(AlphaBetaIndex **hash, TriangleCollection *tris, Point point,
                                                       int *index, double *alpha, double *beta);
-void arrayCachedAlphaBetaIndexForPoints(AlphaBetaIndex **hash, TriangleCollection *tris,
+void arrayCachedAlphaBetaIndexForPoints(AlphaBetaIndexCache *cache, TriangleCollection *tris,
                                   double *points, unsigned int n_points,
                                   int *indexes, double *alphas, double *betas);
 void arrayAlphaBetaIndexForPoints(TriangleCollection *tris,
                                   double *points, unsigned int n_points,
                                   int *indexes, double *alphas, double *betas);
-void arrayMapForPointsAndTargetPoints(AlphaBetaIndex **hash, TriangleCollection *sourceTris,
-                                  TriangleCollection *targetTris, double *points, unsigned int n_points,
-                                  double *mappedPoints);
-void clearCacheAndDelete(AlphaBetaIndex **hash);
+// maps points from the source triangles straight onto the target triangles.
+// indexes[i] is -1 (and the mapped point NaN) for points outside the source.
+void arrayMapForPointsAndTargetPoints(AlphaBetaIndexCache *cache, TriangleCollection *sourceTris,
+                                      TriangleCollection *targetTris, double *points, unsigned int n_points,
+                                      int *indexes, double *mappedPoints);
+void clearCacheAndDelete(AlphaBetaIndexCache *cache);
+
+// affines is (n_triangles, 2, 3) - the affine transform taking each source
+// triangle onto the corresponding target triangle.
+void affinesForTriangles(TriangleCollection *sourceTris, TriangleCollection *targetTris,
+                         double *affines);
+// applies the affine of the triangle given in indexes to each point. All
+// indexes must be valid.
+void arrayApplyAffinePerTriangle(double *affines, int *indexes,
+                                 double *points, unsigned int n_points,
+                                 double *mappedPoints);
+
+
+// out[i] = sum over the 3 vertices v of point i's triangle of
+//          weights[i * 3 + v] * values[vertexIndexes[i * 3 + v]]
+// where each entry of values (and out) is a row of n_values doubles.
+void arrayWeightedSumOfTriangleVertexValues(unsigned int *vertexIndexes, double *weights,
+                                            unsigned int n_points, double *values,
+                                            unsigned int n_values, double *out);
 
+// Warps an image triangle by triangle. Every pixel of the (n_out_rows,
+// n_out_cols) output frame that is True in mask and lies in one of the
+// (output frame) triangles is bilinearly sampled from the (n_rows, n_cols,
+// n_channels) image at the position given by that triangle's affine (see
+// affinesForTriangles). Samples falling outside the image are 0. covered
+// must be zeroed by the caller, and is set to 1 for every pixel written.
+void warpImageByTriangles(TriangleCollection *tris, double *affines,
+                          double *image, unsigned int n_rows, unsigned int n_cols,
+                          unsigned int n_channels, unsigned char *mask,
+                          unsigned int n_out_rows, unsigned int n_out_cols,
+                          double *out, unsigned char *covered);
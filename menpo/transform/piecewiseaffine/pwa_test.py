@@ -1,7 +1,11 @@
 import numpy as np
-from numpy.testing import assert_equal
-from menpo.transform.piecewiseaffine.base import DiscreteAffinePWA
+from numpy.testing import assert_equal, assert_allclose
+from menpo.transform.piecewiseaffine.base import (DiscreteAffinePWA,
+                                                  CachedPWA)
 from menpo.shape import PointCloud, TriMesh
+from menpo.model import PCAModel
+from menpo.transform import PiecewiseAffine
+from menpo.transform.modeldriven import ModelDrivenTransform
 
 src_points = np.array([[0, 0], [1, 0], [0, 1], [1, 1]])
 tgt_points = np.array([[0, 0], [2, 0], [0, 2], [2, 3]])
@@ -25,3 +29,53 @@ def test_pwa_discrete_affine_transforms():
     assert(len(pwa.transforms) == 2)
     assert_equal(pwa.transforms[0].h_matrix, a_affine)
     assert_equal(pwa.transforms[1].h_matrix, b_affine)
+
+
+def test_pwa_cached_apply_matches_discrete():
+    points = np.array([[0.1, 0.1], [0.7, 0.2], [0.9, 0.8], [0.2, 0.6]])
+    discrete = DiscreteAffinePWA(src, tgt)
+    cached = CachedPWA(src, tgt)
+    assert_allclose(cached.apply(points), discrete.apply(points))
+
+
+def test_pwa_cached_apply_after_target_change():
+    points = np.array([[0.1, 0.1], [0.7, 0.2], [0.9, 0.8], [0.2, 0.6]])
+    new_tgt = PointCloud(np.array([[0, 1], [2, 1], [1, 2], [3, 4]]))
+    cached = CachedPWA(src, tgt)
+    cached.apply(points)
+    cached.set_target(new_tgt)
+    assert_allclose(cached.apply(points),
+                    DiscreteAffinePWA(src, new_tgt).apply(points))
+
+
+def test_pwa_weight_points_sparse_matches_dense():
+    points = np.array([[0.1, 0.1], [0.7, 0.2], [0.9, 0.8], [0.2, 0.6]])
+    cached = CachedPWA(src, tgt)
+    index, weights = cached.weight_points_sparse(points)
+    dense = np.zeros((points.shape[0], src.n_points))
+    dense[np.arange(points.shape[0])[:, None], index] = weights
+    assert_allclose(cached.weight_points(points)[..., 0], dense)
+    assert_allclose(cached.weight_points(points)[..., 1], dense)
+
+
+def test_mdtransform_pwa_sparse_jacobian_matches_dense():
+    rng = np.random.RandomState(0)
+    shape = np.array([[0.0, 0.0],
+                      [0.0, 1.0],
+                      [1.0, 0.0],
+                      [1.0, 1.0],
+                      [0.4, 0.6]])
+    samples = [PointCloud(shape + 0.05 * rng.randn(*shape.shape))
+               for _ in range(6)]
+    md = ModelDrivenTransform(PCAModel(samples), PiecewiseAffine)
+    # random points inside each triangle of the source
+    source = md.transform.source
+    barycentric = rng.dirichlet(np.ones(3), size=(source.n_tris, 4))
+    points = np.einsum('tpk, tkd -> tpd', barycentric,
+                       source.points[source.trilist]).reshape([-1, 2])
+
+    dW_dp = md.jacobian(points)
+    assert(isinstance(md.dW_dX, tuple))
+    dense = np.einsum('ild, lpd -> ipd', md.transform.weight_points(points),
+                      md.pdm.model.jacobian)
+    assert_allclose(dW_dp, dense)
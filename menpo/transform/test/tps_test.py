@@ -145,3 +145,52 @@ def test_tps_weight_points():
                           [1.73368403, 1.73368403],
                           [-0.18368403, -0.18368403]]])
     assert_allclose(result, expected, rtol=10 ** -6)
+
+
+def test_tps_jacobian_points_finite_differences():
+    tps = ThinPlateSplines(src, tgt_perturbed)
+    pts = np.array([[-0.1, -1.0], [-0.5, 1.0], [0.3, 0.2]])
+    result = tps.jacobian_points(pts)
+    eps = 1e-6
+    for d in range(2):
+        step = np.zeros(2)
+        step[d] = eps
+        expected = (tps.apply(pts + step) - tps.apply(pts - step)) / (2 * eps)
+        assert_allclose(result[:, d, :], expected, rtol=1e-5, atol=1e-8)
+
+
+def test_tps_weight_points_contracted_with_basis():
+    tps = ThinPlateSplines(src, tgt_perturbed)
+    pts = np.array([[-0.1, -1.0], [-0.5, 1.0], [2.1, -2.5]])
+    basis = np.random.randn(4, 3, 2)
+    expected = np.einsum('nld, lqd -> nqd', tps.weight_points(pts), basis)
+    assert_allclose(tps.weight_points(pts, basis=basis), expected)
+    expected = np.einsum('nld, lqd -> nqd', tps.jacobian_source(pts), basis)
+    assert_allclose(tps.jacobian_source(pts, basis=basis), expected)
+
+
+def test_tps_coefficients_for_targets():
+    tps = ThinPlateSplines(src, tgt)
+    targets = [tgt, tgt_perturbed, PointCloud(perturbed_tgt_landmarks * 2)]
+    result = tps.coefficients_for_targets(targets)
+    for t, c in zip(targets, result):
+        tps.set_target(t)
+        assert_allclose(c, tps.coefficients)
+        assert_allclose(c, np.linalg.solve(tps.l, tps.y.T), atol=1e-12)
+
+
+def test_tps_shares_system_between_instances():
+    a = ThinPlateSplines(src, tgt)
+    b = ThinPlateSplines(src, tgt_perturbed)
+    assert(a.l is b.l)
+
+
+def test_tps_approximate_apply_within_max_error():
+    tps = ThinPlateSplines(src, tgt_perturbed)
+    approx = ThinPlateSplines(src, tgt_perturbed, max_error=0.01)
+    r, c = np.meshgrid(np.linspace(-1.5, 1.5, 200),
+                       np.linspace(-1.5, 1.5, 200), indexing='ij')
+    pts = np.vstack([r.ravel(), c.ravel()]).T
+    error = np.sqrt(np.sum((approx.apply(pts) - tps.apply(pts)) ** 2,
+                           axis=1))
+    assert(np.max(error) <= 0.01)
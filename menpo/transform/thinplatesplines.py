@@ -1,10 +1,74 @@
+from collections import OrderedDict
+import threading
 import numpy as np
-from scipy.spatial import distance
-from menpo.basis.rbf import R2LogR2
+from menpo.basis.rbf import R2LogR2, CompiledBasisFunction
+from menpo.basis.crbf import rbf_tps_source_jacobian
+from menpo.interpolation.cinterp import interp2
 
 from .base import Transform, Alignment, Invertible
 
 
+# The TPS system matrix (and so its inverse) only depends on the source
+# landmarks and the kernel. When building an AAM every training image is
+# warped from the same reference frame, so the inverses for the default
+# kernel of the last few sources seen are shared between instances.
+_SYSTEM_CACHE_SIZE = 8
+_system_cache = OrderedDict()
+# guards _system_cache, as TPS may be fitted from several threads at once
+_system_cache_lock = threading.Lock()
+
+
+def _build_system(source, kernel):
+    r"""
+    The TPS system matrix ``l`` for the given source landmarks, the
+    kernel evaluated at the source ``k``, the affine block ``p`` and the
+    inverse of ``l``.
+    """
+    n_points = source.shape[0]
+    k = kernel.apply(source)
+    p = np.concatenate([np.ones([n_points, 1]), source], axis=1)
+    o = np.zeros([3, 3])
+    top_l = np.concatenate([k, p], axis=1)
+    bot_l = np.concatenate([p.T, o], axis=1)
+    l = np.concatenate([top_l, bot_l], axis=0)
+    # l is symmetric but indefinite (the affine block), so it is inverted
+    # rather than Cholesky factorised. The inverse is needed as is for the
+    # Jacobians.
+    inv_l = np.linalg.inv(l)
+    for a in (k, p, l, inv_l):
+        a.flags.writeable = False
+    return k, p, l, inv_l
+
+
+# The approximate evaluation starts with this many grid cells along the
+# longest side of the points' bounding box, and gives up (evaluating exactly)
+# once the grid would have more than 1 / _MAX_GRID_FRACTION of the points.
+_INITIAL_GRID_CELLS = 16
+_MAX_GRID_FRACTION = 4
+# The number of points (and cell centres) the approximation is checked on.
+_N_VALIDATION_POINTS = 1024
+
+
+def _cached_default_system(source):
+    key = (source.shape, source.tostring())
+    with _system_cache_lock:
+        system = _system_cache.pop(key, None)
+        if system is not None:
+            # reinsert as the most recently used
+            _system_cache[key] = system
+            return system
+    # the inversion is done outside the lock, so that fits of other sources
+    # aren't held up by it
+    system = _build_system(source, R2LogR2(source))
+    with _system_cache_lock:
+        # another thread may have built the same system in the meantime
+        system = _system_cache.pop(key, system)
+        if len(_system_cache) >= _SYSTEM_CACHE_SIZE:
+            _system_cache.popitem(last=False)
+        _system_cache[key] = system
+    return system
+
+
 # Note we inherit from Alignment first to get it's n_dims behavior
 class ThinPlateSplines(Alignment, Transform, Invertible):
     r"""
@@ -25,6 +89,16 @@ class ThinPlateSplines(Alignment, Transform, Invertible):
         The kernel to apply.
 
         Default: :class:`menpo.basis.rbf.R2LogR2`
+    max_error : float, optional
+        If set, dense applications of the TPS (such as warping an image with
+        :meth:`menpo.image.base.Image.warp_to`) are approximated: the TPS
+        is evaluated exactly on a regular grid over the points and bicubically
+        interpolated in between. The grid is refined until the error, measured
+        on a sample of the points and of the grid cells, is below
+        ``max_error`` (in the units of the points, e.g. pixels). If
+        ``None`` the TPS is always evaluated exactly.
+
+        Default: ``None``
 
     Raises
     ------
@@ -32,27 +106,58 @@ class ThinPlateSplines(Alignment, Transform, Invertible):
         TPS is only with on 2-dimensional data
     """
 
-    def __init__(self, source, target, kernel=None):
+    def __init__(self, source, target, kernel=None, max_error=None):
         Alignment.__init__(self, source, target)
         if self.n_dims != 2:
             raise ValueError('TPS can only be used on 2D data.')
         if kernel is None:
             kernel = R2LogR2(source.points)
+            self.k, self.p, self.l, self._inv_l = _cached_default_system(
+                self.source.points)
+        else:
+            self.k, self.p, self.l, self._inv_l = _build_system(
+                self.source.points, kernel)
         self.kernel = kernel
-        self.k = self.kernel.apply(self.source.points)
-        self.p = np.concatenate(
-            [np.ones([self.n_points, 1]), self.source.points], axis=1)
-        o = np.zeros([3, 3])
-        top_l = np.concatenate([self.k, self.p], axis=1)
-        bot_l = np.concatenate([self.p.T, o], axis=1)
-        self.l = np.concatenate([top_l, bot_l], axis=0)
+        self.max_error = max_error
         self.v, self.y, self.coefficients = None, None, None
         self._build_coefficients()
 
     def _build_coefficients(self):
         self.v = self.target.points.T.copy()
         self.y = np.hstack([self.v, np.zeros([2, 3])])
-        self.coefficients = np.linalg.solve(self.l, self.y.T)
+        # the last three entries of y are zero, so only the first n_points
+        # columns of inv(l) are needed
+        self.coefficients = self._inv_l[:, :self.n_points].dot(
+            self.target.points)
+
+    def coefficients_for_targets(self, targets):
+        r"""
+        The TPS coefficients from this source to each of many targets,
+        computed in a single matrix product against the cached inverse of
+        the system matrix.
+
+        Parameters
+        ----------
+        targets : (T, N, 2) ndarray or list of :class:`menpo.shape.PointCloud`
+            The targets to compute coefficients for.
+
+        Returns
+        -------
+        coefficients : (T, N + 3, 2) ndarray
+            The coefficients for each target, such that
+            ``coefficients[t]`` is what :attr:`coefficients` would be after
+            ``set_target(targets[t])``.
+        """
+        if not isinstance(targets, np.ndarray):
+            targets = np.array([t.points for t in targets])
+        n_targets = targets.shape[0]
+        if targets.shape[1:] != (self.n_points, 2):
+            raise ValueError('targets must be (T, {}, 2)'.format(
+                self.n_points))
+        # (N, T * 2): every target side by side
+        y = targets.transpose(1, 0, 2).reshape(self.n_points, -1)
+        c = self._inv_l[:, :self.n_points].dot(y)
+        return c.reshape(-1, n_targets, 2).transpose(1, 0, 2)
 
     def _sync_state_from_target(self):
         # now the target is updated, we only have to rebuild the
@@ -75,6 +180,13 @@ class ThinPlateSplines(Alignment, Transform, Invertible):
         """
         if points.shape[1] != self.n_dims:
             raise ValueError('TPS can only be applied to 2D data.')
+        if self.max_error is not None:
+            f = self._apply_approximate(points, self.max_error)
+            if f is not None:
+                return f
+        return self._apply_exact(points)
+
+    def _apply_exact(self, points):
         x = points[..., 0][:, None]
         y = points[..., 1][:, None]
         # calculate the affine coefficients of the warp
@@ -84,21 +196,79 @@ class ThinPlateSplines(Alignment, Transform, Invertible):
         c_affine_y = self.coefficients[-1]
         # the affine warp component
         f_affine = c_affine_c + c_affine_x * x + c_affine_y * y
-        # calculate a distance matrix (for L2 Norm) between every source
-        # and the target
-        kernel_dist = self.kernel.apply(points)
         # grab the affine free components of the warp
         c_affine_free = self.coefficients[:-3]
-        # build the affine free warp component
-        f_affine_free = kernel_dist.dot(c_affine_free)
+        # build the affine free warp component - the kernel is evaluated
+        # between every point and source and contracted with the
+        # coefficients in one go (no (N, L) distance matrix is built)
+        f_affine_free = self.kernel.apply_and_contract(points, c_affine_free)
         return f_affine + f_affine_free
 
+    def _apply_approximate(self, points, max_error):
+        r"""
+        Evaluates the TPS exactly on a regular grid covering ``points`` and
+        bicubically interpolates the displacement field at the points,
+        halving the grid spacing until the error on a sample of the points
+        and of the interior of their cells (where it is largest) is within
+        ``max_error``.
+
+        Returns ``None`` if no grid small enough to be worthwhile meets
+        the bound, in which case the points should be evaluated exactly.
+        """
+        n_points = points.shape[0]
+        lo, hi = points.min(axis=0), points.max(axis=0)
+        extent = np.max(hi - lo)
+        if n_points == 0 or extent == 0:
+            return None
+        # a deterministic sample of the points to check the error on. The
+        # kernel is least smooth at the landmarks, so those (and the cells
+        # around them) are always checked.
+        sample = points[::max(n_points // _N_VALIDATION_POINTS, 1)]
+        landmarks = self.source.points
+        sample = np.vstack([sample, landmarks[np.all((landmarks >= lo) &
+                                                     (landmarks <= hi),
+                                                     axis=1)]])
+        spacing = float(extent) / _INITIAL_GRID_CELLS
+        while True:
+            # one node of margin either side so that every bicubic stencil
+            # is inside the grid
+            origin = lo - spacing
+            shape = np.ceil((hi - lo) / spacing).astype(np.int) + 3
+            if np.prod(shape) * _MAX_GRID_FRACTION > n_points:
+                return None
+            r, c = np.meshgrid(np.arange(shape[0]), np.arange(shape[1]),
+                               indexing='ij')
+            nodes = origin + spacing * np.vstack([r.ravel(), c.ravel()]).T
+            # interpolate the displacement so the bicubic interpolant
+            # degrades gracefully at the edge of the grid
+            field = (self._apply_exact(nodes) - nodes).reshape(
+                tuple(shape) + (2,))
+            centres = origin + spacing * (
+                np.floor((sample - origin) / spacing) + 0.5)
+            check = np.vstack([sample, centres, centres + 0.25 * spacing,
+                               centres - 0.25 * spacing])
+            error = np.max(np.sqrt(np.sum(
+                (self._interpolate_field(field, origin, spacing, check) -
+                 self._apply_exact(check)) ** 2, axis=1)))
+            if error <= max_error:
+                return self._interpolate_field(field, origin, spacing,
+                                               points)
+            spacing /= 2.0
+
+    @staticmethod
+    def _interpolate_field(field, origin, spacing, points):
+        grid_points = (points - origin) / spacing
+        displacement = interp2(field, grid_points[:, 0], grid_points[:, 1],
+                               mode='bicubic')
+        return points + displacement
+
     @property
     def has_true_inverse(self):
         return False
 
     def _build_pseudoinverse(self):
-        return ThinPlateSplines(self.target, self.source, kernel=self.kernel)
+        return ThinPlateSplines(self.target, self.source, kernel=self.kernel,
+                                max_error=self.max_error)
 
     def jacobian_points(self, points):
         """
@@ -120,20 +290,15 @@ class ThinPlateSplines(Alignment, Transform, Invertible):
             e.g. [7, 0, 1] = derivative wrt x on the y coordinate of the
             8th point.
         """
-        dk_dx = np.zeros((points.shape[0] + 3,   # i
-                          self.source.n_points,  # k
-                          self.source.n_dims))   # l
-        dk_dx[:-3, :] = self.kernel.jacobian_points(points)
-
-        affine_derivative = np.array([[0, 0],
-                                      [1, 0],
-                                      [0, 1]])
-        dk_dx[-3:, :] = affine_derivative[:, None]
-
-        return np.einsum('ij, ikl -> klj', self.coefficients, dk_dx)
+        # the affine component contributes its linear part to every point,
+        # the affine free component is the kernel derivative contracted with
+        # the affine free coefficients
+        dW_dx = self.kernel.jacobian_points_and_contract(
+            points, self.coefficients[:-3])
+        dW_dx += self.coefficients[-2:]
+        return dW_dx
 
-    # TODO: revise me
-    def jacobian_source(self, points):
+    def jacobian_source(self, points, basis=None):
         """
         Calculates the Jacobian of the TPS warp wrt to the source landmark
         position.
@@ -142,59 +307,23 @@ class ThinPlateSplines(Alignment, Transform, Invertible):
         ----------
         points : (N, D)
             Points at which the Jacobian will be evaluated.
+        basis : (P, Q, D) ndarray, optional
+            If provided, the Jacobian is contracted with this (e.g. the
+            Jacobian of a shape model, dp/dq) as it is computed, and the
+            (N, P, D) Jacobian is never built.
 
         Returns
         -------
         dW/dp : (N, P, D) ndarray
             The Jacobian of the transform wrt to the source landmarks evaluated
-            at the previous points.
+            at the previous points. If ``basis`` was provided, the
+            (N, Q, D) contraction dW/dq is returned instead.
         """
-        from menpo.shape import PointCloud
-        points_pc = PointCloud(points)
-        n_lms = self.n_points
-        n_pts = points_pc.n_points
-
-        kernel_dist = self.kernel.apply(points)
-        k = np.concatenate([kernel_dist, np.ones([n_pts, 1]), points], axis=1)
-        inv_L = np.linalg.inv(self.l)
+        return self._source_jacobian(points, self.coefficients,
+                                     point_coefficients=self.coefficients[:-3],
+                                     basis=basis)
 
-        dL_dx = np.zeros(self.l.shape + (n_lms,))
-        dL_dy = np.zeros(self.l.shape + (n_lms,))
-        aux = self.kernel.jacobian_points(self.source.points)
-        dW_dx = np.zeros((n_pts, n_lms, 2))
-
-        # Fix log(0)
-        for i in np.arange(n_lms):
-            dK_dxyi = np.zeros((self.k.shape + (2,)))
-            dK_dxyi[i] = aux[i]
-            dK_dxyi[:, i] = -aux[:, i]
-
-            dP_dxi = np.zeros_like(self.p)
-            dP_dyi = np.zeros_like(self.p)
-            dP_dxi[i, 1] = -1
-            dP_dyi[i, 2] = -1
-
-            dL_dx[:n_lms, :n_lms, i] = dK_dxyi[..., 0]
-            dL_dx[:n_lms, n_lms:, i] = dP_dxi
-            dL_dx[n_lms:, :n_lms, i] = dP_dxi.T
-
-            dL_dy[:n_lms, :n_lms, i] = dK_dxyi[..., 1]
-            dL_dy[:n_lms, n_lms:, i] = dP_dyi
-            dL_dy[n_lms:, :n_lms, i] = dP_dyi.T
-            # new bit
-            aux3 = np.zeros((n_pts, self.y.shape[1], 2))
-            aux3[:, i, :] = self.kernel.jacobian_points(points)[:, i, :]
-            omega_x = -inv_L.dot(dL_dx[..., i].dot(inv_L))
-            dW_dx[:, i, 0] = (k.dot(omega_x).dot(self.y[0]) +
-                              aux3[..., 0].dot(self.coefficients[:, 0]))
-            omega_y = -inv_L.dot(dL_dy[..., i].dot(inv_L))
-            dW_dx[:, i, 1] = (k.dot(omega_y).dot(self.y[1]) +
-                              aux3[..., 1].dot(self.coefficients[:, 1]))
-
-        return dW_dx
-
-    # TODO: revise this function and try to speed it up!!!
-    def weight_points(self, points):
+    def weight_points(self, points, basis=None):
         """
         Calculates the Jacobian of the TPS warp wrt to the source landmarks
         assuming that he target is equal to the source. This is a special
@@ -206,55 +335,60 @@ class ThinPlateSplines(Alignment, Transform, Invertible):
         ----------
         points : (N, D)
             Points at which the Jacobian will be evaluated.
+        basis : (P, Q, D) ndarray, optional
+            If provided, the Jacobian is contracted with this (e.g. the
+            Jacobian of a shape model, dp/dq) as it is computed, and the
+            (N, P, D) Jacobian is never built.
 
         Returns
         -------
         dW/dp : (N, P, D) ndarray
             The Jacobian of the transform wrt to the source landmarks evaluated
             at the previous points and assuming that the target is equal to
-            the source.
+            the source. If ``basis`` was provided, the (N, Q, D) contraction
+            dW/dq is returned instead.
         """
-        from menpo.shape import PointCloud
-        points_pc = PointCloud(points)
+        coefficients = self._inv_l[:, :self.n_points].dot(self.source.points)
+        return self._source_jacobian(points, coefficients, basis=basis)
+
+    def _source_jacobian(self, points, coefficients, point_coefficients=None,
+                         basis=None):
+        r"""
+        The Jacobian wrt the source landmarks of the TPS with the given
+        ``coefficients`` (``inv(L).dot(y.T)`` for some target ``y``).
+
+        Moving the i'th source landmark only changes row and column i of the
+        TPS system matrix ``L``, so rather than building ``dL/dp`` and
+        ``-inv(L) dL/dp inv(L)`` per landmark, with ``g = inv(L) k(x)``::
+
+            dW[x, i, d] = -g_i R[i, d] + C[i, d] S[x, i, d]
+                          + g_i C[L + 1 + d, d] + g_{L + 1 + d} C[i, d]
+
+        where ``R[i, d] = sum_b dU/dx_d(p_i, p_b) C[b, d]`` and
+        ``S[x, i, d] = sum_a g_a dU/dx_d(p_a, p_i)``. For
+        :class:`menpo.basis.rbf.CompiledBasisFunction` kernels this is done
+        natively.
+        """
+        inv_l = self._inv_l
+        if isinstance(self.kernel, CompiledBasisFunction):
+            return rbf_tps_source_jacobian(
+                self.kernel.kernel, self.kernel.parameter, points,
+                self.source.points, inv_l, coefficients,
+                point_coefficients=point_coefficients, basis=basis)
         n_lms = self.n_points
-        n_pts = points_pc.n_points
-
-        # TPS kernel (nonlinear + affine)
-        kernel_dist = self.kernel.apply(points)
-        k = np.concatenate([kernel_dist, np.ones([n_pts, 1]), points], axis=1)
-        inv_L = np.linalg.inv(self.l)
-
-        dL_dx = np.zeros(self.l.shape + (n_lms,))
-        dL_dy = np.zeros(self.l.shape + (n_lms,))
-        s = self.source.points[:, np.newaxis, :] - self.source.points
-        r = distance.squareform(distance.pdist(self.source.points))
-        r[r == 0] = 1
-        aux = 2 * (1 + np.log(r ** 2))[..., None] * s
-        dW_dx = np.zeros((n_pts, n_lms, 2))
-
-        pseudo_target = np.hstack([self.source.points.T, np.zeros([2, 3])])
-
-        for i in np.arange(n_lms):
-            dK_dxyi = np.zeros((self.k.shape + (2,)))
-            dK_dxyi[i] = aux[i]
-            dK_dxyi[:, i] = -aux[:, i]
-
-            dP_dxi = np.zeros_like(self.p)
-            dP_dyi = np.zeros_like(self.p)
-            dP_dxi[i, 1] = -1
-            dP_dyi[i, 2] = -1
-
-            dL_dx[:n_lms, :n_lms, i] = dK_dxyi[..., 0]
-            dL_dx[:n_lms, n_lms:, i] = dP_dxi
-            dL_dx[n_lms:, :n_lms, i] = dP_dxi.T
-
-            dL_dy[:n_lms, :n_lms, i] = dK_dxyi[..., 1]
-            dL_dy[:n_lms, n_lms:, i] = dP_dyi
-            dL_dy[n_lms:, :n_lms, i] = dP_dyi.T
-
-            omega_x = -inv_L.dot(dL_dx[..., i].dot(inv_L))
-            dW_dx[:, i, 0] = k.dot(omega_x).dot(pseudo_target[0])
-            omega_y = -inv_L.dot(dL_dy[..., i].dot(inv_L))
-            dW_dx[:, i, 1] = k.dot(omega_y).dot(pseudo_target[1])
-
+        k = np.concatenate([self.kernel.apply(points),
+                            np.ones([points.shape[0], 1]), points], axis=1)
+        g = k.dot(inv_l)
+        aux = self.kernel.jacobian_points(self.source.points)
+        c = coefficients[:n_lms]
+        R = np.einsum('ibd, bd -> id', aux, c)
+        S = np.einsum('na, aid -> nid', g[:, :n_lms], aux)
+        affine = np.array([coefficients[-2, 0], coefficients[-1, 1]])
+        dW_dx = (g[:, :n_lms, None] * (affine - R) + c * S +
+                 g[:, None, -2:] * c)
+        if point_coefficients is not None:
+            dW_dx += (self.kernel.jacobian_points(points) *
+                      point_coefficients)
+        if basis is not None:
+            dW_dx = np.einsum('nld, lqd -> nqd', dW_dx, basis)
         return dW_dx
@@ -9,6 +9,7 @@ cython_modules = ["menpo/geodesics/kirsanov.pyx",
                   "menpo/shape/mesh/normals.pyx",
                   "menpo/interpolation/cinterp.pyx",
                   "menpo/transform/piecewiseaffine/fastpwa.pyx",
+                  "menpo/basis/crbf.pyx",
                   "menpo/features/cppimagewindowiterator.pyx"]
 
 cython_exts = cythonize(cython_modules, nthreads=2, quiet=True)